@@ -0,0 +1,111 @@
+#include <opencv2/core/core.hpp>
+#include "monogenicProcessor.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// This program measures the time taken to process a single frame, and its
+// scaling with the number of threads, in the default mode and in latency mode.
+// Each configuration processes a random frame at 4K (3840 x 2160) and 8K
+// (7680 x 4320) resolutions and finds the feature symmetry and asymmetry. The
+// median time over a number of repetitions is reported after preparing the
+// processor.
+// A breakdown of the time taken by each stage at 8K follows, including
+// hardware counter measurements on Linux.
+// An optional command line argument gives the number of repetitions
+
+// Namespaces
+using namespace cv;
+using namespace std;
+
+// Median time in milliseconds to process a frame and find two outputs
+static double timeFrames(monogenic::monogenicProcessor &mgFilts, const Mat &frame, const int repetitions)
+{
+	Mat fs, fa;
+	vector<double> times;
+
+	// Warm up the buffers and threads
+	mgFilts.prepare({monogenic::OUTPUT_FS,monogenic::OUTPUT_FA},frame.type());
+
+	for(int r = 0; r < repetitions; ++r)
+	{
+		const int64 start = getTickCount();
+		mgFilts.findMonogenicSignal(frame);
+		mgFilts.getOutput(monogenic::OUTPUT_FS,fs);
+		mgFilts.getOutput(monogenic::OUTPUT_FA,fa);
+		times.push_back(1000.0*double(getTickCount() - start)/getTickFrequency());
+	}
+
+	sort(times.begin(),times.end());
+	return times[times.size()/2];
+}
+
+int main( int argc, char** argv )
+{
+	const int repetitions = (argc > 1) ? std::max(1,atoi(argv[1])) : 5;
+	const Size frame_sizes[2] = {Size(3840,2160),Size(7680,4320)};
+	const string frame_names[2] = {"4K","8K"};
+
+	#ifdef _OPENMP
+	const int max_threads = omp_get_max_threads();
+	#else
+	const int max_threads = 1;
+	#endif
+
+	// Thread counts to test (powers of two up to the maximum)
+	vector<int> thread_counts;
+	for(int n = 1; n < max_threads; n *= 2)
+		thread_counts.push_back(n);
+	thread_counts.push_back(max_threads);
+
+	cout << "size\tthreads\tdefault (ms)\tlatency (ms)\tspeed-up" << endl;
+
+	for(int s = 0; s < 2; ++s)
+	{
+		Mat frame(frame_sizes[s],CV_8U);
+		randu(frame,Scalar::all(0),Scalar::all(256));
+
+		monogenic::monogenicProcessor mgFilts(frame.rows,frame.cols,50);
+
+		for(size_t t = 0; t < thread_counts.size(); ++t)
+		{
+			#ifdef _OPENMP
+			omp_set_num_threads(thread_counts[t]);
+			#endif
+			setNumThreads(thread_counts[t]);
+
+			mgFilts.setLatencyMode(false);
+			const double default_ms = timeFrames(mgFilts,frame,repetitions);
+			mgFilts.setLatencyMode(true);
+			const double latency_ms = timeFrames(mgFilts,frame,repetitions);
+
+			cout << frame_names[s] << "\t" << thread_counts[t] << "\t" << default_ms << "\t" << latency_ms << "\t" << default_ms/latency_ms << endl;
+		}
+	}
+
+	// Break down the time of the default mode at the largest size by stage,
+	// with hardware counters where the system allows
+	Mat frame(frame_sizes[1],CV_8U);
+	randu(frame,Scalar::all(0),Scalar::all(256));
+	monogenic::monogenicProcessor mgFilts(frame.rows,frame.cols,50);
+	mgFilts.prepare({monogenic::OUTPUT_FS,monogenic::OUTPUT_FA});
+	mgFilts.enableProfiling();
+	Mat fs, fa;
+	for(int r = 0; r < repetitions; ++r)
+	{
+		mgFilts.findMonogenicSignal(frame);
+		mgFilts.getOutput(monogenic::OUTPUT_FS,fs);
+		mgFilts.getOutput(monogenic::OUTPUT_FA,fa);
+	}
+	vector<monogenic::stageStatistics> stats;
+	mgFilts.getStageStatistics(stats);
+	cout << endl;
+	monogenic::writeStageStatistics(cout,stats);
+
+	return 0;
+}
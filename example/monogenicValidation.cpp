@@ -0,0 +1,198 @@
+#include <opencv2/core/core.hpp>
+#include "monogenicProcessor.h"
+#include "monogenicReference.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+
+// This program checks each of the fast paths of the monogenicProcessor class
+// against a straightforward double precision reference implementation. Each
+// synthetic image (chirp, rings, step edges and noise) is processed at a size
+// that needs no padding and at an awkward size (with prime dimensions), and
+// every output is compared with the reference against its documented error
+// bound (see documentedErrorBound). A line is printed for each path, image
+// and output, and the program returns a non-zero exit code if any output
+// exceeds its bound.
+// The backward pass is then checked by comparing the gradients of a loss
+// (a random weighting of several outputs) with respect to the input image,
+// wavelength and shape parameter with central differences of the same loss
+// found with the reference.
+// An optional command line argument gives the wavelength (default 16)
+
+// Namespaces
+using namespace cv;
+using namespace std;
+
+static const char* const C_OUTPUT_NAMES[] =
+{
+	"even", "odd_x", "odd_y", "odd_mag", "orientation", "amplitude", "fs", "fa", "pos_fs", "neg_fs", "local_phase"
+};
+
+// A way of calculating the monogenic signal to be checked
+struct fastPath
+{
+	string name;
+	monogenic::paddingMode padding;
+	bool latency;
+	int memory_strategies;
+	bool recursive;
+	monogenic::accuracyClass accuracy;
+};
+
+// Loss as a weighted sum of outputs of the reference
+static double referenceLoss(const monogenic::monogenicReference &reference, const vector<monogenic::outputType> &outputs, const vector<Mat> &weights)
+{
+	double loss = 0.0;
+	for(size_t k = 0; k < outputs.size(); ++k)
+	{
+		Mat result, weights_64;
+		reference.getOutput(outputs[k],result);
+		weights[k].convertTo(weights_64,CV_64F);
+		loss += result.dot(weights_64);
+	}
+	return loss;
+}
+
+// Relative difference of an analytic gradient from a numerical one
+static double relativeError(const double analytic, const double numerical)
+{
+	const double scale = std::max(std::abs(analytic),std::abs(numerical));
+	return (scale > 0.0) ? std::abs(analytic - numerical)/scale : 0.0;
+}
+
+int main( int argc, char** argv )
+{
+	const float wavelength = (argc > 1) ? float(atof(argv[1])) : 16.0f;
+	const Size sizes[2] = {Size(256,192),Size(331,241)};
+
+	const vector<fastPath> paths =
+	{
+		{"default",monogenic::PADDING_OPTIMAL,false,monogenic::MEMORY_DEFAULT,false,monogenic::ACCURACY_SINGLE_PRECISION},
+		{"latency",monogenic::PADDING_OPTIMAL,true,monogenic::MEMORY_DEFAULT,false,monogenic::ACCURACY_SINGLE_PRECISION},
+		{"no_padding",monogenic::PADDING_NONE,false,monogenic::MEMORY_DEFAULT,false,monogenic::ACCURACY_SINGLE_PRECISION},
+		{"auto_padding",monogenic::PADDING_AUTO,false,monogenic::MEMORY_DEFAULT,false,monogenic::ACCURACY_SINGLE_PRECISION},
+		{"fused_outputs",monogenic::PADDING_OPTIMAL,false,monogenic::MEMORY_FUSED_OUTPUTS,false,monogenic::ACCURACY_SINGLE_PRECISION},
+		{"drop_spectrum",monogenic::PADDING_OPTIMAL,false,monogenic::MEMORY_DROP_SPECTRUM,false,monogenic::ACCURACY_SINGLE_PRECISION},
+		{"half_filters",monogenic::PADDING_OPTIMAL,false,monogenic::MEMORY_HALF_FILTERS,false,monogenic::ACCURACY_HALF_PRECISION_FILTERS},
+		{"recursive",monogenic::PADDING_OPTIMAL,false,monogenic::MEMORY_DEFAULT,true,monogenic::ACCURACY_RECURSIVE}
+	};
+
+	vector<monogenic::outputType> outputs;
+	for(int k = monogenic::OUTPUT_EVEN; k <= monogenic::OUTPUT_LOCAL_PHASE; ++k)
+		outputs.push_back(monogenic::outputType(k));
+
+	int n_failures = 0;
+	cout << "path\tsize\timage\toutput\tmax_error\tmax_bound\trms_error\trms_bound\tresult" << endl;
+
+	for(size_t p = 0; p < paths.size(); ++p)
+	{
+		for(int s = 0; s < 2; ++s)
+		{
+			monogenic::monogenicProcessor mgFilts(sizes[s].height,sizes[s].width,wavelength,0.5,0.16,paths[p].padding);
+			mgFilts.setLatencyMode(paths[p].latency);
+			mgFilts.setMemoryStrategies(paths[p].memory_strategies);
+			monogenic::monogenicReference reference(sizes[s].height,sizes[s].width,wavelength,0.5,0.16,mgFilts.getTransformSize());
+
+			for(int pattern = 0; pattern < monogenic::N_SYNTHETIC_PATTERNS; ++pattern)
+			{
+				Mat image;
+				monogenic::makeSyntheticImage(monogenic::syntheticPattern(pattern),sizes[s],image);
+
+				if(paths[p].recursive)
+					mgFilts.findMonogenicSignalRecursive(image);
+				else
+					mgFilts.findMonogenicSignal(image);
+				reference.findMonogenicSignal(image);
+
+				vector<monogenic::referenceComparison> results;
+				monogenic::compareWithReference(mgFilts,reference,outputs,paths[p].accuracy,results);
+
+				for(size_t k = 0; k < results.size(); ++k)
+				{
+					const monogenic::referenceComparison &r = results[k];
+					if(!r.passed) ++n_failures;
+					cout << paths[p].name << "\t" << sizes[s].width << "x" << sizes[s].height << "\t"
+					     << monogenic::syntheticPatternName(monogenic::syntheticPattern(pattern)) << "\t"
+					     << C_OUTPUT_NAMES[r.output] << "\t" << r.max_error << "\t" << r.bound.max_error << "\t"
+					     << r.rms_error << "\t" << r.bound.rms_error << "\t" << (r.passed ? "pass" : "FAIL") << endl;
+				}
+			}
+		}
+	}
+
+	cout << endl << n_failures << " output(s) outside their bounds" << endl;
+
+	// Gradient checks on a small image, where the loss is found in double
+	// precision for the central differences
+	const Size grad_size(64,48);
+	const float grad_sigma = 0.55f;
+	const double grad_tolerance = 2e-3;
+	const vector<monogenic::outputType> grad_outputs = {monogenic::OUTPUT_FS,monogenic::OUTPUT_FA,monogenic::OUTPUT_LOCAL_PHASE,monogenic::OUTPUT_AMPLITUDE};
+	Mat grad_image, grad_image_64;
+	monogenic::makeSyntheticImage(monogenic::PATTERN_CHIRP,grad_size,grad_image);
+	grad_image.convertTo(grad_image_64,CV_64F);
+
+	RNG rng(2);
+	vector<Mat> weights(grad_outputs.size());
+	for(size_t k = 0; k < grad_outputs.size(); ++k)
+	{
+		weights[k].create(grad_size,CV_32F);
+		rng.fill(weights[k],RNG::NORMAL,Scalar::all(0.0),Scalar::all(1.0));
+	}
+
+	monogenic::monogenicProcessor grad_filts(grad_size.height,grad_size.width,wavelength,grad_sigma);
+	grad_filts.findMonogenicSignal(grad_image);
+	Mat input_grad;
+	float wavelength_grad, sigma_grad;
+	grad_filts.backward(grad_outputs,weights,input_grad,&wavelength_grad,&sigma_grad);
+	const Size transform_size = grad_filts.getTransformSize();
+
+	// Derivative of the input along a random direction
+	Mat direction(grad_size,CV_64F);
+	rng.fill(direction,RNG::NORMAL,Scalar::all(0.0),Scalar::all(1.0));
+	Mat input_grad_64;
+	input_grad.convertTo(input_grad_64,CV_64F);
+	const double step = 1e-2;
+	monogenic::monogenicReference grad_ref(grad_size.height,grad_size.width,wavelength,grad_sigma,0.16,transform_size);
+	grad_ref.findMonogenicSignal(grad_image_64 + step*direction);
+	const double loss_plus = referenceLoss(grad_ref,grad_outputs,weights);
+	grad_ref.findMonogenicSignal(grad_image_64 - step*direction);
+	const double loss_minus = referenceLoss(grad_ref,grad_outputs,weights);
+	const double input_numerical = (loss_plus - loss_minus)/(2.0*step);
+	const double input_analytic = input_grad_64.dot(direction);
+
+	// Derivatives with respect to the parameters
+	double param_numerical[2];
+	const double param_steps[2] = {1e-4*wavelength,1e-5};
+	for(int p = 0; p < 2; ++p)
+	{
+		double losses[2];
+		for(int side = 0; side < 2; ++side)
+		{
+			const double delta = (side == 0) ? param_steps[p] : -param_steps[p];
+			monogenic::monogenicReference param_ref(grad_size.height,grad_size.width,wavelength + ((p == 0) ? delta : 0.0),grad_sigma + ((p == 1) ? delta : 0.0),0.16,transform_size);
+			param_ref.findMonogenicSignal(grad_image_64);
+			losses[side] = referenceLoss(param_ref,grad_outputs,weights);
+		}
+		param_numerical[p] = (losses[0] - losses[1])/(2.0*param_steps[p]);
+	}
+
+	const string grad_names[3] = {"input","wavelength","shape_sigma"};
+	const double analytic[3] = {input_analytic,wavelength_grad,sigma_grad};
+	const double numerical[3] = {input_numerical,param_numerical[0],param_numerical[1]};
+	int n_grad_failures = 0;
+	cout << endl << "gradient\tanalytic\tnumerical\trelative_error\tresult" << endl;
+	for(int g = 0; g < 3; ++g)
+	{
+		const double error = relativeError(analytic[g],numerical[g]);
+		const bool passed = error <= grad_tolerance;
+		if(!passed) ++n_grad_failures;
+		cout << grad_names[g] << "\t" << analytic[g] << "\t" << numerical[g] << "\t" << error << "\t" << (passed ? "pass" : "FAIL") << endl;
+	}
+	cout << endl << n_grad_failures << " gradient(s) outside the tolerance" << endl;
+
+	return ((n_failures > 0) || (n_grad_failures > 0)) ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+#ifndef FOVEATEDPROCESSOR_H
+#define FOVEATEDPROCESSOR_H
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "monogenicProcessor.h"
+
+namespace monogenic
+{
+
+// Calculates the monogenic signal and derived quantities at full resolution
+// within one or more square regions of interest (foveae) that may move
+// between images, and at reduced resolution elsewhere. The periphery is
+// processed at a resolution reduced by a factor of two for each decimation
+// level, so the cost is dominated by the size of the foveae
+class foveatedProcessor
+{
+	public:
+
+	// Simple constructor
+	foveatedProcessor();
+
+	// Full constructor
+	// The image dimensions, wavelength, shape parameter and threshold are as
+	// for monogenicProcessor. fovea_size is the side of the square foveae and
+	// decimation_levels is the number of times the periphery is halved in
+	// resolution
+	foveatedProcessor(const int image_size_y, const int image_size_x, const float wavelength, const int fovea_size, const int decimation_levels = 2, const float shape_sigma = 0.5, const float sym_thresh = 0.16);
+
+	// Reinitialise an object, parameters as in constructor
+	void initialise(const int image_size_y, const int image_size_x, const float wavelength, const int fovea_size, const int decimation_levels = 2, const float shape_sigma = 0.5, const float sym_thresh = 0.16);
+
+	// Sets the centres of the foveae for subsequent images. Foveae near the
+	// image edges are moved to lie within the image
+	void setFoveae(const std::vector<cv::Point> &centres);
+
+	// Calculate the representation of the input image I, as in
+	// monogenicProcessor
+	void findMonogenicSignal(const cv::Mat &I);
+
+	// Returns one of the outputs as a pyramid with decimation_levels + 1
+	// levels, where level l has the image size reduced by a factor of 2^l.
+	// The last level is the output of the periphery, and the others are
+	// interpolated from it, except that within the foveae level 0 contains
+	// the full resolution output
+	void getOutputPyramid(const outputType output, std::vector<cv::Mat> &pyramid);
+
+	// Returns the rectangles of the foveae in full resolution image coordinates
+	void getFoveae(std::vector<cv::Rect> &rects);
+
+	private:
+	// Data
+	monogenicProcessor periphery;
+	std::vector<monogenicProcessor> foveae;
+	std::vector<cv::Rect> fovea_rects;
+	std::vector<cv::Size> level_sizes;
+	cv::Mat decimated;
+	int ysize, xsize, fov_size, margin, levels;
+	float wl, sigma_onf, T;
+};
+
+} // end of namespace
+
+#endif
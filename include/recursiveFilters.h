@@ -0,0 +1,23 @@
+#ifndef RECURSIVEFILTERS_H
+#define RECURSIVEFILTERS_H
+#include <opencv2/core/core.hpp>
+
+namespace monogenic
+{
+
+// Smooths a single channel CV_32F image in place with a Gaussian of standard
+// deviation sigma (pixels, at least 0.5), using the third order recursive
+// filter of Young and van Vliet (1995) forwards and backwards along the rows
+// and then the columns. The cost per pixel does not depend on sigma
+void recursiveGaussian(cv::Mat &im, const float sigma);
+
+// Finds the standard deviations of the two Gaussians whose difference best
+// approximates, in the frequency domain, a log Gabor filter with the given
+// centre wavelength and shape parameter, with the peak of the difference at
+// the centre frequency. Also returns the gain needed to give the difference
+// a peak of one, and the RMS error between the two radial profiles
+void fitDoGToLogGabor(const float wavelength, const float shape_sigma, float &sigma_1, float &sigma_2, float &gain, float &rms_error);
+
+} // end of namespace
+
+#endif
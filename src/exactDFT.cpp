@@ -0,0 +1,276 @@
+#include "exactDFT.h"
+
+using namespace std;
+using namespace cv;
+
+namespace monogenic
+{
+
+// Largest prime factor handled efficiently by the mixed radix algorithm
+static const int C_MAX_MIXED_RADIX_FACTOR = 13;
+
+// Number of rows transformed together by one thread in parallel mode
+static const int C_ROWS_PER_BLOCK = 16;
+
+// Side length of the square tiles used for transposes in parallel mode (a
+// tile of complex floats fits comfortably in the L1 cache)
+static const int C_TRANSPOSE_TILE = 32;
+
+// Simple constructor
+exactDFT::exactDFT()
+: n_rows(0), n_cols(0), bluestein_rows(false), bluestein_cols(false), parallel_passes(false)
+{
+}
+
+void exactDFT::setParallel(const bool parallel)
+{
+	parallel_passes = parallel;
+}
+
+// Decide the algorithm for each dimension and precompute the Bluestein data
+void exactDFT::plan(const int rows, const int cols)
+{
+	n_rows = rows;
+	n_cols = cols;
+	bluestein_cols = needsBluestein(cols);
+	bluestein_rows = needsBluestein(rows);
+	if(bluestein_cols) planBluestein(cols,row_plan);
+	if(bluestein_rows) planBluestein(rows,col_plan);
+}
+
+bool exactDFT::usesBluestein() const
+{
+	return bluestein_rows || bluestein_cols;
+}
+
+// Trial division is fine for image dimensions
+int exactDFT::largestPrimeFactor(int n)
+{
+	int largest = 1;
+	for(int p = 2; p*p <= n; ++p)
+	{
+		while(n % p == 0)
+		{
+			largest = p;
+			n /= p;
+		}
+	}
+	return std::max(largest,n);
+}
+
+// Each radix-p stage costs about p complex operations per element for the
+// generic butterflies, with the specialised radix 2, 3 and 5 butterflies
+// costing less. Bluestein needs two transforms of the efficient length m and
+// three complex multiplications per element (the kernel transform is
+// precomputed)
+double exactDFT::transformCost(const int n)
+{
+	double mixed_radix = 0.0;
+	int rem = n;
+	for(int p = 2; p*p <= rem; ++p)
+	{
+		while(rem % p == 0)
+		{
+			mixed_radix += (p <= 5) ? 5.0*std::log2(double(p)) : 2.5*p;
+			rem /= p;
+		}
+	}
+	if(rem > 1)
+		mixed_radix += (rem <= 5) ? 5.0*std::log2(double(rem)) : 2.5*rem;
+	mixed_radix *= n;
+
+	if(largestPrimeFactor(n) <= C_MAX_MIXED_RADIX_FACTOR)
+		return mixed_radix;
+
+	const int m = getOptimalDFTSize(2*n - 1);
+	const double bluestein = 2.0*transformCost(m) + 18.0*n;
+	return std::min(mixed_radix,bluestein);
+}
+
+double exactDFT::transformCost(const int rows, const int cols)
+{
+	return double(rows)*transformCost(cols) + double(cols)*transformCost(rows);
+}
+
+// Bluestein is used where a large prime factor makes it cheaper
+bool exactDFT::needsBluestein(const int n)
+{
+	if(largestPrimeFactor(n) <= C_MAX_MIXED_RADIX_FACTOR)
+		return false;
+
+	const int m = getOptimalDFTSize(2*n - 1);
+	return (2.0*transformCost(m) + 18.0*n) < transformCost(n);
+}
+
+// The DFT X_k = sum_j x_j exp(-2.pi.i.j.k/n) is rewritten using
+// j.k = (j^2 + k^2 - (k-j)^2)/2 as X_k = w_k . sum_j (x_j.w_j).conj(w_(k-j)),
+// with w_k = exp(-i.pi.k^2/n), which is a convolution that can be computed
+// with DFTs of any length m >= 2n-1
+void exactDFT::planBluestein(const int n, bluesteinPlan &bp)
+{
+	bp.n = n;
+	bp.m = getOptimalDFTSize(2*n - 1);
+	bp.chirp.create(1,n,CV_32FC2);
+	Mat kernel = Mat::zeros(1,bp.m,CV_32FC2);
+
+	Vec2f* const chirp_ptr = bp.chirp.ptr<Vec2f>();
+	Vec2f* const kernel_ptr = kernel.ptr<Vec2f>();
+	for(int k = 0; k < n; ++k)
+	{
+		// Reduce k^2 modulo 2n to keep the angle accurate
+		const long long k_sq = (static_cast<long long>(k)*k) % (2LL*n);
+		const double angle = CV_PI*double(k_sq)/double(n);
+		chirp_ptr[k] = Vec2f(std::cos(angle),-std::sin(angle));
+		kernel_ptr[k] = Vec2f(std::cos(angle),std::sin(angle));
+		if(k > 0)
+			kernel_ptr[bp.m - k] = kernel_ptr[k];
+	}
+
+	dft(kernel,bp.kernel_spectrum);
+}
+
+// Forward transforms of each row of the data, of length n, in place
+void exactDFT::transformRows(Mat &data, const bluesteinPlan *bp, const int n)
+{
+	if(bp == nullptr)
+	{
+		dft(data,data,DFT_ROWS);
+		return;
+	}
+
+	const Vec2f* const chirp_ptr = bp->chirp.ptr<Vec2f>();
+	const Vec2f* const kern_ptr = bp->kernel_spectrum.ptr<Vec2f>();
+	Mat work = Mat::zeros(data.rows,bp->m,CV_32FC2);
+
+	for(int r = 0; r < data.rows; ++r)
+	{
+		const Vec2f* const in_ptr = data.ptr<Vec2f>(r);
+		Vec2f* const work_ptr = work.ptr<Vec2f>(r);
+		for(int k = 0; k < n; ++k)
+		{
+			work_ptr[k][0] = in_ptr[k][0]*chirp_ptr[k][0] - in_ptr[k][1]*chirp_ptr[k][1];
+			work_ptr[k][1] = in_ptr[k][0]*chirp_ptr[k][1] + in_ptr[k][1]*chirp_ptr[k][0];
+		}
+	}
+
+	dft(work,work,DFT_ROWS);
+
+	for(int r = 0; r < data.rows; ++r)
+	{
+		Vec2f* const work_ptr = work.ptr<Vec2f>(r);
+		for(int k = 0; k < bp->m; ++k)
+		{
+			const float re = work_ptr[k][0]*kern_ptr[k][0] - work_ptr[k][1]*kern_ptr[k][1];
+			const float im = work_ptr[k][0]*kern_ptr[k][1] + work_ptr[k][1]*kern_ptr[k][0];
+			work_ptr[k] = Vec2f(re,im);
+		}
+	}
+
+	idft(work,work,DFT_ROWS + DFT_SCALE);
+
+	for(int r = 0; r < data.rows; ++r)
+	{
+		const Vec2f* const work_ptr = work.ptr<Vec2f>(r);
+		Vec2f* const out_ptr = data.ptr<Vec2f>(r);
+		for(int k = 0; k < n; ++k)
+		{
+			out_ptr[k][0] = work_ptr[k][0]*chirp_ptr[k][0] - work_ptr[k][1]*chirp_ptr[k][1];
+			out_ptr[k][1] = work_ptr[k][0]*chirp_ptr[k][1] + work_ptr[k][1]*chirp_ptr[k][0];
+		}
+	}
+}
+
+// Transpose of a complex image, working on square tiles in parallel so that
+// both the reads and the writes stay within a few cache lines at a time
+void exactDFT::blockedTranspose(const Mat &src, Mat &dst)
+{
+	dst.create(src.cols,src.rows,CV_32FC2);
+	const int n_tile_rows = (src.rows + C_TRANSPOSE_TILE - 1) / C_TRANSPOSE_TILE;
+	const int n_tile_cols = (src.cols + C_TRANSPOSE_TILE - 1) / C_TRANSPOSE_TILE;
+
+	#pragma omp parallel for collapse(2)
+	for(int tj = 0; tj < n_tile_rows; ++tj)
+	{
+		for(int ti = 0; ti < n_tile_cols; ++ti)
+		{
+			const int j_end = std::min((tj+1)*C_TRANSPOSE_TILE,src.rows);
+			const int i_end = std::min((ti+1)*C_TRANSPOSE_TILE,src.cols);
+			for(int j = tj*C_TRANSPOSE_TILE; j < j_end; ++j)
+			{
+				const Vec2f* const src_ptr = src.ptr<Vec2f>(j);
+				for(int i = ti*C_TRANSPOSE_TILE; i < i_end; ++i)
+					dst.ptr<Vec2f>(i)[j] = src_ptr[i];
+			}
+		}
+	}
+}
+
+// One pass of 1D transforms along the rows, split into blocks of rows in
+// parallel mode
+void exactDFT::transformPass(Mat &data, const bluesteinPlan *bp, const int n) const
+{
+	if(!parallel_passes)
+	{
+		transformRows(data,bp,n);
+		return;
+	}
+
+	const int n_blocks = (data.rows + C_ROWS_PER_BLOCK - 1) / C_ROWS_PER_BLOCK;
+	#pragma omp parallel for schedule(dynamic)
+	for(int b = 0; b < n_blocks; ++b)
+	{
+		Mat block = data.rowRange(b*C_ROWS_PER_BLOCK,std::min((b+1)*C_ROWS_PER_BLOCK,data.rows));
+		transformRows(block,bp,n);
+	}
+}
+
+// Transform along the rows, then transpose and transform along the columns
+void exactDFT::forward(const Mat &src, Mat &dst) const
+{
+	if(!usesBluestein() && !parallel_passes)
+	{
+		dft(src,dst);
+		return;
+	}
+
+	Mat data = src.clone(), data_t;
+	transformPass(data,bluestein_cols ? &row_plan : nullptr,n_cols);
+	if(parallel_passes) blockedTranspose(data,data_t);
+	else transpose(data,data_t);
+	transformPass(data_t,bluestein_rows ? &col_plan : nullptr,n_rows);
+	if(parallel_passes) blockedTranspose(data_t,dst);
+	else transpose(data_t,dst);
+}
+
+// The inverse DFT is the conjugate of the forward DFT of the conjugate
+void exactDFT::inverse(const Mat &src, Mat &dst, const bool scale) const
+{
+	if(!usesBluestein() && !parallel_passes)
+	{
+		idft(src,dst,scale ? DFT_SCALE : 0);
+		return;
+	}
+
+	Mat conj_src(src.size(),CV_32FC2);
+	const float factor = scale ? 1.0f/(float(n_rows)*float(n_cols)) : 1.0f;
+	#pragma omp parallel for if(parallel_passes)
+	for(int j = 0; j < src.rows; ++j)
+	{
+		const Vec2f* const src_ptr = src.ptr<Vec2f>(j);
+		Vec2f* const conj_ptr = conj_src.ptr<Vec2f>(j);
+		for(int i = 0; i < src.cols; ++i)
+			conj_ptr[i] = Vec2f(src_ptr[i][0],-src_ptr[i][1]);
+	}
+
+	forward(conj_src,dst);
+
+	#pragma omp parallel for if(parallel_passes)
+	for(int j = 0; j < dst.rows; ++j)
+	{
+		Vec2f* const dst_ptr = dst.ptr<Vec2f>(j);
+		for(int i = 0; i < dst.cols; ++i)
+			dst_ptr[i] = Vec2f(factor*dst_ptr[i][0],-factor*dst_ptr[i][1]);
+	}
+}
+
+} // end of namespace
@@ -0,0 +1,74 @@
+#ifndef EXACTDFT_H
+#define EXACTDFT_H
+#include <opencv2/core/core.hpp>
+
+namespace monogenic
+{
+
+// Complex 2D DFT of an arbitrary fixed size, without padding. Dimensions
+// whose prime factors are small are transformed with cv::dft, which uses
+// mixed radix algorithms (including for factors of 7, 11 and 13), while
+// dimensions with large prime factors use Bluestein's algorithm, which
+// re-expresses the DFT as a convolution performed with DFTs of an efficient
+// size. Once planned, the transforms may be called from several threads at
+// once. In parallel mode, each pass of a single transform is itself split
+// across the OpenMP threads, which reduces the latency of one transform at
+// the cost of some overhead
+class exactDFT
+{
+	public:
+
+	// Simple constructor
+	exactDFT();
+
+	// Plans transforms of the given size
+	void plan(const int rows, const int cols);
+
+	// Sets whether the passes of each transform are split across threads
+	void setParallel(const bool parallel);
+
+	// Whether any dimension needs Bluestein's algorithm (if not, cv::dft may
+	// be used directly on the whole image)
+	bool usesBluestein() const;
+
+	// Forward transform of a CV_32FC2 image
+	void forward(const cv::Mat &src, cv::Mat &dst) const;
+
+	// Inverse transform of a CV_32FC2 image, scaled by the number of pixels if
+	// scale is true
+	void inverse(const cv::Mat &src, cv::Mat &dst, const bool scale) const;
+
+	// Returns the largest prime factor of n
+	static int largestPrimeFactor(int n);
+
+	// Estimated number of operations for a 1D complex DFT of length n by the
+	// cheaper of the mixed radix and Bluestein algorithms
+	static double transformCost(const int n);
+
+	// Estimated number of operations for the 2D complex DFT of the given size
+	static double transformCost(const int rows, const int cols);
+
+	private:
+
+	// Precomputed data for Bluestein transforms of one length
+	struct bluesteinPlan
+	{
+		int n, m;
+		cv::Mat chirp;            // exp(-i.pi.k^2/n) for k < n
+		cv::Mat kernel_spectrum;  // DFT of the conjugate chirp wrapped to length m
+	};
+
+	static void planBluestein(const int n, bluesteinPlan &bp);
+	static bool needsBluestein(const int n);
+	static void transformRows(cv::Mat &data, const bluesteinPlan *bp, const int n);
+	static void blockedTranspose(const cv::Mat &src, cv::Mat &dst);
+	void transformPass(cv::Mat &data, const bluesteinPlan *bp, const int n) const;
+
+	int n_rows, n_cols;
+	bool bluestein_rows, bluestein_cols, parallel_passes;
+	bluesteinPlan row_plan, col_plan;
+};
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,114 @@
+#include "foveatedProcessor.h"
+#include <opencv2/imgproc/imgproc.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace monogenic
+{
+
+// Simple constructor without initialisation
+foveatedProcessor::foveatedProcessor()
+{
+}
+
+// Constructor with initialisation
+foveatedProcessor::foveatedProcessor(const int image_size_y, const int image_size_x, const float wavelength, const int fovea_size, const int decimation_levels, const float shape_sigma, const float sym_thresh)
+{
+	initialise(image_size_y,image_size_x,wavelength,fovea_size,decimation_levels,shape_sigma,sym_thresh);
+}
+
+// Set up the periphery processor at the decimated size. The fovea processors
+// are created when the foveae are set
+void foveatedProcessor::initialise(const int image_size_y, const int image_size_x, const float wavelength, const int fovea_size, const int decimation_levels, const float shape_sigma, const float sym_thresh)
+{
+	ysize = image_size_y;
+	xsize = image_size_x;
+	wl = wavelength;
+	sigma_onf = shape_sigma;
+	T = sym_thresh;
+	levels = decimation_levels;
+
+	// Each fovea is processed with a margin of one wavelength around it to
+	// keep it clear of the boundary effects at the edges of its window
+	margin = cvCeil(wl);
+	fov_size = std::min(fovea_size + 2*margin,std::min(ysize,xsize));
+
+	// Sizes of each level as produced by pyrDown
+	level_sizes.resize(levels+1);
+	level_sizes[0] = Size(xsize,ysize);
+	for(int l = 1; l <= levels; ++l)
+		level_sizes[l] = Size((level_sizes[l-1].width + 1)/2,(level_sizes[l-1].height + 1)/2);
+
+	periphery.initialise(level_sizes[levels].height,level_sizes[levels].width,wl/float(1 << levels),sigma_onf,T);
+
+	foveae.clear();
+	fovea_rects.clear();
+}
+
+// Place the fovea windows (including their margins) within the image
+void foveatedProcessor::setFoveae(const vector<Point> &centres)
+{
+	const size_t old_n = foveae.size();
+	foveae.resize(centres.size());
+	for(size_t f = old_n; f < foveae.size(); ++f)
+		foveae[f].initialise(fov_size,fov_size,wl,sigma_onf,T);
+
+	fovea_rects.resize(centres.size());
+	for(size_t f = 0; f < centres.size(); ++f)
+	{
+		const int x = std::min(std::max(centres[f].x - fov_size/2,0),xsize - fov_size);
+		const int y = std::min(std::max(centres[f].y - fov_size/2,0),ysize - fov_size);
+		fovea_rects[f] = Rect(x,y,fov_size,fov_size);
+	}
+}
+
+// Process the decimated image and each fovea window
+void foveatedProcessor::findMonogenicSignal(const Mat &I)
+{
+	decimated = I;
+	for(int l = 0; l < levels; ++l)
+		pyrDown(decimated,decimated,level_sizes[l+1]);
+	periphery.findMonogenicSignal(decimated);
+
+	for(size_t f = 0; f < foveae.size(); ++f)
+		foveae[f].findMonogenicSignal(I(fovea_rects[f]));
+}
+
+// Build the pyramid from the periphery, then insert the foveae (excluding
+// their margins where possible) into the full resolution level
+void foveatedProcessor::getOutputPyramid(const outputType output, vector<Mat> &pyramid)
+{
+	// Angles cannot be interpolated across their wrap-around
+	const int interp = ((output == OUTPUT_ORIENTATION) || (output == OUTPUT_LOCAL_PHASE)) ? INTER_NEAREST : INTER_LINEAR;
+
+	pyramid.resize(levels+1);
+
+	Mat coarse;
+	periphery.getOutput(output,coarse);
+	coarse(Rect(Point(0,0),level_sizes[levels])).copyTo(pyramid[levels]);
+	for(int l = levels - 1; l >= 0; --l)
+		resize(pyramid[l+1],pyramid[l],level_sizes[l],0,0,interp);
+
+	for(size_t f = 0; f < foveae.size(); ++f)
+	{
+		const Rect &rect = fovea_rects[f];
+		const int left = (rect.x > 0) ? margin : 0;
+		const int top = (rect.y > 0) ? margin : 0;
+		const int right = (rect.x + rect.width < xsize) ? margin : 0;
+		const int bottom = (rect.y + rect.height < ysize) ? margin : 0;
+		const Rect inner(left,top,std::max(rect.width - left - right,0),std::max(rect.height - top - bottom,0));
+
+		Mat fine;
+		foveae[f].getOutput(output,fine);
+		fine(inner).copyTo(pyramid[0](Rect(rect.x + inner.x,rect.y + inner.y,inner.width,inner.height)));
+	}
+}
+
+// Returns the fovea windows
+void foveatedProcessor::getFoveae(vector<Rect> &rects)
+{
+	rects = fovea_rects;
+}
+
+} // end of namespace
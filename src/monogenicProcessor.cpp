@@ -1,5 +1,9 @@
 #include "monogenicProcessor.h"
+#include "recursiveFilters.h"
 #include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <limits>
 
 using namespace std;
 using namespace cv;
@@ -7,19 +11,55 @@ using namespace cv;
 namespace monogenic
 {
 
+// Rearranges the pixels of an image according to one of the dihedral
+// transforms
+static void transformGrid(const Mat &src, Mat &dst, const dihedralTransform transform)
+{
+	switch(transform)
+	{
+		case DIHEDRAL_IDENTITY:
+			src.copyTo(dst);
+			break;
+		case DIHEDRAL_ROTATE_90:
+			rotate(src,dst,ROTATE_90_CLOCKWISE);
+			break;
+		case DIHEDRAL_ROTATE_180:
+			rotate(src,dst,ROTATE_180);
+			break;
+		case DIHEDRAL_ROTATE_270:
+			rotate(src,dst,ROTATE_90_COUNTERCLOCKWISE);
+			break;
+		case DIHEDRAL_FLIP_X:
+			flip(src,dst,1);
+			break;
+		case DIHEDRAL_FLIP_Y:
+			flip(src,dst,0);
+			break;
+		case DIHEDRAL_TRANSPOSE:
+			transpose(src,dst);
+			break;
+		case DIHEDRAL_ANTI_TRANSPOSE:
+			transpose(src,dst);
+			flip(dst,dst,-1);
+			break;
+	}
+}
+
 // Simple constructor without initialisation
 monogenicProcessor::monogenicProcessor()
+: memory_strategies(MEMORY_DEFAULT)
 {
 }
 
 // Constructor with initialisation
-monogenicProcessor::monogenicProcessor(const int image_size_y, const int image_size_x, const float wavelength, const float shape_sigma, const float sym_thresh)
+monogenicProcessor::monogenicProcessor(const int image_size_y, const int image_size_x, const float wavelength, const float shape_sigma, const float sym_thresh, const paddingMode padding)
+: memory_strategies(MEMORY_DEFAULT)
 {
-	initialise(image_size_y,image_size_x,wavelength,shape_sigma,sym_thresh);
+	initialise(image_size_y,image_size_x,wavelength,shape_sigma,sym_thresh,padding);
 }
 
 // Constructor
-void monogenicProcessor::initialise(const int image_size_y, const int image_size_x, const float wavelength, const float shape_sigma, const float sym_thresh)
+void monogenicProcessor::initialise(const int image_size_y, const int image_size_x, const float wavelength, const float shape_sigma, const float sym_thresh, const paddingMode padding)
 {
 	// Copy input parameters
 	xsize = image_size_x;
@@ -29,35 +69,93 @@ void monogenicProcessor::initialise(const int image_size_y, const int image_size
 	T = sym_thresh;
 
 	// Set up parameters for Fourier transforming the incoming images
-	pad_xsize = getOptimalDFTSize(xsize);
-	pad_ysize = getOptimalDFTSize(ysize);
+	choosePadding(padding);
+	transform.plan(pad_ysize,pad_xsize);
+	setLatencyMode(false);
 	planes[1] = Mat::zeros(pad_ysize,pad_xsize,CV_32F);
 
 	// Create the monogenic filters
-	createLogGaborRieszFilt();
+	radial_profile.reset();
+	use_recursive = false;
+	result_recursive = false;
+	createLogGaborRieszFilt(wl,even_filter,odd_filter);
+	compactFilters();
 
 	// Set all flags to false
-	even_valid = false;
-	odd_valid = false;
-	even_mag_valid = false;
-	odd_mag_ori_valid = false;
-	amp_valid = false;
-	sym_valid = false;
-	asym_valid = false;
-	or_sym_valid = false;
-	or_asym_valid = false;
-	lp_valid = false;
+	invalidateOutputs();
+
+	// The recursive approximation is fitted when first needed
+	rec_fitted = false;
+
+	// Any registration reference or templates were for the old geometry
+	reg_ref_valid = false;
+	reg_ref_log_polar_valid = false;
+	clearMatchTemplates();
+	clearTemporalFilter();
+	clearSpectralFilters();
+}
+
+// Choose the padded size in each dimension. For automatic padding, each
+// combination of padding or not in each dimension is costed as three DFTs
+// (one forward and two inverse) plus a fixed amount of work per pixel for the
+// padding, spectral multiplications and outputs
+void monogenicProcessor::choosePadding(const paddingMode padding)
+{
+	switch(padding)
+	{
+		case PADDING_OPTIMAL:
+			pad_xsize = getOptimalDFTSize(xsize);
+			pad_ysize = getOptimalDFTSize(ysize);
+			break;
+		case PADDING_NONE:
+			pad_xsize = xsize;
+			pad_ysize = ysize;
+			break;
+		case PADDING_AUTO:
+		{
+			const double per_pixel_cost = 40.0;
+			const int x_options[2] = {xsize,getOptimalDFTSize(xsize)};
+			const int y_options[2] = {ysize,getOptimalDFTSize(ysize)};
+			double best_cost = std::numeric_limits<double>::max();
+			for(int a = 0; a < 2; ++a)
+			{
+				for(int b = 0; b < 2; ++b)
+				{
+					const double cost = 3.0*exactDFT::transformCost(y_options[a],x_options[b]) + per_pixel_cost*double(y_options[a])*double(x_options[b]);
+					if(cost < best_cost)
+					{
+						best_cost = cost;
+						pad_ysize = y_options[a];
+						pad_xsize = x_options[b];
+					}
+				}
+			}
+			break;
+		}
+	}
+}
+
+// Forward DFT of a complex image of the padded size
+void monogenicProcessor::forwardDFT(const Mat &src, Mat &dst) const
+{
+	transform.forward(src,dst);
+}
+
+// Inverse DFT of a complex image of the padded size
+void monogenicProcessor::inverseDFT(const Mat &src, Mat &dst, const bool scale) const
+{
+	transform.inverse(src,dst,scale);
 }
 
 // Function to construct a log Gabor filter (even) and its
 // complex-valued Riesz transform
-void monogenicProcessor::createLogGaborRieszFilt(void)
+void monogenicProcessor::createLogGaborRieszFilt(const float wavelength, Mat &even_filt, Mat &odd_filt)
 {
 
 	MatIterator_<Vec2f> even_it, odd_it, even_end;
 	int i = 0, j = 0;
 	float w_x, w_y, w, f;
-	const float w0 = 1.0/wl;
+	const float w0 = 1.0/wavelength;
 	const float scale_const = 1.0/(2.0*std::log(sigma_onf)*std::log(sigma_onf));
 	const float xsizef = float (pad_xsize);
 	const float ysizef = float(pad_ysize);
@@ -67,12 +165,12 @@ void monogenicProcessor::createLogGaborRieszFilt(void)
 	const int yswitch = (pad_ysize % 2 == 0) ? pad_ysize/2 : (pad_ysize+1)/2;
 
 	// Set filters to zero
-	even_filter= Mat::zeros(pad_ysize,pad_xsize, CV_32FC2);
-	odd_filter = Mat::zeros(pad_ysize,pad_xsize, CV_32FC2);
+	even_filt = Mat::zeros(pad_ysize,pad_xsize, CV_32FC2);
+	odd_filt = Mat::zeros(pad_ysize,pad_xsize, CV_32FC2);
 
 	// Iterate through pixels of the filter
-	even_end = even_filter.end<Vec2f>();
-	for (even_it = even_filter.begin<Vec2f>(), odd_it = odd_filter.begin<Vec2f>(); even_it != even_end; ++even_it, ++odd_it)
+	even_end = even_filt.end<Vec2f>();
+	for (even_it = even_filt.begin<Vec2f>(), odd_it = odd_filt.begin<Vec2f>(); even_it != even_end; ++even_it, ++odd_it)
 	{
 		// Find freq value of this coordinate
 		w_x = (i < xswitch) ? float(i)/xsizef : (float(i)-xsizef)/xsizef;
@@ -103,48 +201,231 @@ void monogenicProcessor::createLogGaborRieszFilt(void)
 	}
 }
 
-// This function is used to input a new image. The even and odd filter responses are found
-// via the DFT, and other images are invalidated.
-void monogenicProcessor::findMonogenicSignal(const Mat &I)
+// Construct the even filter with an arbitrary radial profile, and its
+// Riesz transform. The profile is evaluated at every frequency of the DFT
+// grid, so that the filter is exact whatever the wavelength (a look-up table
+// would squeeze the pass band of long wavelengths into a few entries). This
+// only happens when the profile or geometry changes
+void monogenicProcessor::createRadialRieszFilt(const radialProfile &profile, Mat &even_filt, Mat &odd_filt)
+{
+	const float xsizef = float(pad_xsize);
+	const float ysizef = float(pad_ysize);
+
+	// Find coordinates at which we switch to negative frequencies
+	const int xswitch = (pad_xsize % 2 == 0) ? pad_xsize/2 : (pad_xsize+1)/2;
+	const int yswitch = (pad_ysize % 2 == 0) ? pad_ysize/2 : (pad_ysize+1)/2;
+
+	even_filt = Mat::zeros(pad_ysize,pad_xsize, CV_32FC2);
+	odd_filt = Mat::zeros(pad_ysize,pad_xsize, CV_32FC2);
+
+	#pragma omp parallel for
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		// In an even dimension, the highest frequency component is unpaired
+		// so is left at zero
+		if((pad_ysize % 2 == 0) && (j == yswitch)) continue;
+
+		Vec2f* const even_ptr = even_filt.ptr<Vec2f>(j);
+		Vec2f* const odd_ptr = odd_filt.ptr<Vec2f>(j);
+		const float w_y = (j < yswitch) ? float(-j)/ysizef : (ysizef - float(j))/ysizef;
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			if(((i == 0) && (j == 0)) || ((pad_xsize % 2 == 0) && (i == xswitch))) continue;
+
+			const float w_x = (i < xswitch) ? float(i)/xsizef : (float(i)-xsizef)/xsizef;
+			const float w = std::sqrt(w_x*w_x + w_y*w_y);
+			const float f = profile.response(w);
+
+			even_ptr[i][0] = f;
+			odd_ptr[i][0] = -f*w_y/w;
+			odd_ptr[i][1] = f*w_x/w;
+		}
+	}
+}
+
+// Compares the recursive path to the DFT path by timing the stages of each
+// on blank images of the padded size with the current settings. Operation
+// counts are a poor guide here, as the DFTs are vectorised whereas the
+// recursive filters are limited by their dependencies and make several
+// passes over memory. The DFT path is the forward DFT, the multiplication by
+// the filters and two inverse DFTs, and the recursive path is the band-pass
+// filter, forming the complex even response and the derivatives. Each is run
+// once to allocate its buffers and then timed, taking the faster of two runs
+bool monogenicProcessor::recursiveIsCheaper(const radialProfile &profile)
+{
+	typedef std::chrono::steady_clock clock;
+	const int n_runs = 3;
+	Mat dft_input = Mat::zeros(pad_ysize,pad_xsize,CV_32FC2), dft_spectrum, dft_even, dft_odd;
+	Mat rec_input = Mat::zeros(pad_ysize,pad_xsize,CV_32F), rec_even, rec_odd;
+	const vector<Mat*> dft_responses = {&dft_even,&dft_odd};
+	const Mat rec_imag = Mat::zeros(pad_ysize,pad_xsize,CV_32F);
+	double dft_time = 0.0, recursive_time = 0.0;
+
+	for(int r = 0; r < n_runs; ++r)
+	{
+		const clock::time_point dft_start = clock::now();
+		forwardDFT(dft_input,dft_spectrum);
+		multiplyFilters(dft_spectrum,dft_responses);
+		inverseDFT(dft_even,dft_even,true);
+		inverseDFT(dft_odd,dft_odd,true);
+		const clock::time_point rec_start = clock::now();
+		profile.applyRecursive(rec_input);
+		const Mat rec_planes[2] = {rec_input,rec_imag};
+		merge(rec_planes,2,rec_even);
+		recursiveRiesz(rec_even,profile.centreFrequency(),rec_odd);
+		const clock::time_point rec_end = clock::now();
+
+		if(r == 0) continue;
+		const double dft_run = std::chrono::duration<double>(rec_start - dft_start).count();
+		const double rec_run = std::chrono::duration<double>(rec_end - rec_start).count();
+		dft_time = (r == 1) ? dft_run : std::min(dft_time,dft_run);
+		recursive_time = (r == 1) ? rec_run : std::min(recursive_time,rec_run);
+	}
+
+	return recursive_time < dft_time;
+}
+
+// The approximate Riesz transform of the recursive path. The central
+// difference has frequency response i.sin(2.pi.w), whereas the Riesz
+// transform at the centre frequency should give magnitude one. The y
+// component of the odd part points up the image
+void monogenicProcessor::recursiveRiesz(const Mat &even, const float w_centre, Mat &odd) const
+{
+	const float deriv_scale = 0.5f / std::sin(2.0f*float(CV_PI)*std::min(w_centre,0.25f));
+	odd.create(pad_ysize,pad_xsize,CV_32FC2);
+	#pragma omp parallel for
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2f* const even_ptr = even.ptr<Vec2f>(j);
+		const Vec2f* const up_ptr = even.ptr<Vec2f>(std::max(j-1,0));
+		const Vec2f* const down_ptr = even.ptr<Vec2f>(std::min(j+1,pad_ysize-1));
+		Vec2f* const odd_ptr = odd.ptr<Vec2f>(j);
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			odd_ptr[i][0] = deriv_scale*(even_ptr[std::min(i+1,pad_xsize-1)][0] - even_ptr[std::max(i-1,0)][0]);
+			odd_ptr[i][1] = deriv_scale*(up_ptr[i][0] - down_ptr[i][0]);
+		}
+	}
+}
+
+// Switch to a new radial profile
+void monogenicProcessor::setRadialProfile(const std::shared_ptr<const radialProfile> &profile, const bool allow_approximate)
+{
+	radial_profile = profile;
+
+	if(radial_profile)
+	{
+		createRadialRieszFilt(*radial_profile,even_filter,odd_filter);
+		use_recursive = radial_profile->hasRecursiveImplementation()
+			&& (radial_profile->recursiveIsExact() || allow_approximate)
+			&& recursiveIsCheaper(*radial_profile);
+	}
+	else
+	{
+		createLogGaborRieszFilt(wl,even_filter,odd_filter);
+		use_recursive = false;
+	}
+	compactFilters();
+}
+
+// With half precision filters, only the gain of the even filter is kept, in
+// half precision, and the odd filter is formed from it as needed
+void monogenicProcessor::compactFilters()
+{
+	if(!(memory_strategies & MEMORY_HALF_FILTERS))
+	{
+		even_gain_half.release();
+		return;
+	}
+
+	if(even_filter.empty())
+		return;
+
+	Mat filter_planes[2];
+	split(even_filter,filter_planes);
+	filter_planes[0].convertTo(even_gain_half,CV_16F);
+	even_filter.release();
+	odd_filter.release();
+}
+
+// One row of the (real) gain of the even filter, from whichever form is held
+void monogenicProcessor::evenFilterRow(const int j, float *gains) const
+{
+	if(even_gain_half.empty())
+	{
+		const Vec2f* const filt_ptr = even_filter.ptr<Vec2f>(j);
+		for(int i = 0; i < pad_xsize; ++i)
+			gains[i] = filt_ptr[i][0];
+	}
+	else
+	{
+		Mat gain_row(1,pad_xsize,CV_32F,gains);
+		even_gain_half.row(j).convertTo(gain_row,CV_32F);
+	}
+}
+
+// Pads the input image to the transform size, and converts it to greyscale
+// and floating point
+void monogenicProcessor::findPadded(const Mat &I, Mat &padded)
 {
-	Mat temp, padded;
+	Mat grey;
 
 	// Make sure the input image is greyscale
 	if(I.channels() == 3)
 	{
-		cvtColor(I,padded,cv::COLOR_BGR2GRAY);
-		copyMakeBorder(padded, padded, 0, pad_ysize - ysize, 0, pad_xsize - xsize, BORDER_CONSTANT, Scalar::all(0));  //expand input image to optimal size
+		cvtColor(I,grey,cv::COLOR_BGR2GRAY);
+		copyMakeBorder(grey, grey, 0, pad_ysize - ysize, 0, pad_xsize - xsize, BORDER_CONSTANT, Scalar::all(0));  //expand input image to optimal size
 	}
 	else
 	{
 		// Pad the input image
-		copyMakeBorder(I, padded, 0, pad_ysize - ysize, 0, pad_xsize - xsize, BORDER_CONSTANT, Scalar::all(0));  //expand input image to optimal size
+		copyMakeBorder(I, grey, 0, pad_ysize - ysize, 0, pad_xsize - xsize, BORDER_CONSTANT, Scalar::all(0));  //expand input image to optimal size
 	}
 
-	padded.convertTo(planes[0],CV_32F);
-	merge(planes, 2, temp);
-
-	// Take the DFT
-	dft(temp,temp);
+	grey.convertTo(padded,CV_32F);
+}
 
-	// Perform odd and even calculations in parallel
-	#pragma omp parallel sections
+// Pads the input image and takes its DFT
+void monogenicProcessor::findSpectrum(const Mat &I, Mat &spectrum)
+{
+	if(latency_mode && (I.channels() == 1))
 	{
-		#pragma omp section
-		{
-			// Use the even filter
-			mulSpectrums(temp,even_filter,even_im_cmplx,0);
-			idft(even_im_cmplx,even_im_cmplx,DFT_SCALE);
-		}
-		#pragma omp section
+		// Convert, pad and interleave with the zero imaginary part in one
+		// parallel pass
+		spectrum.create(pad_ysize,pad_xsize,CV_32FC2);
+		#pragma omp parallel
 		{
-			// Use the odd filter
-			mulSpectrums(temp,odd_filter,odd_im_cmplx,0);
-			idft(odd_im_cmplx,odd_im_cmplx,DFT_SCALE);
+			Mat row_f;
+			#pragma omp for
+			for(int j = 0; j < pad_ysize; ++j)
+			{
+				Vec2f* const spec_ptr = spectrum.ptr<Vec2f>(j);
+				int i = 0;
+				if(j < ysize)
+				{
+					I.row(j).convertTo(row_f,CV_32F);
+					const float* const row_ptr = row_f.ptr<float>();
+					for( ; i < xsize; ++i)
+						spec_ptr[i] = Vec2f(row_ptr[i],0.0f);
+				}
+				for( ; i < pad_xsize; ++i)
+					spec_ptr[i] = Vec2f(0.0f,0.0f);
+			}
 		}
 	}
+	else
+	{
+		findPadded(I,planes[0]);
+		merge(planes, 2, spectrum);
+	}
 
-	// Set all flags to false
+	// Take the DFT
+	forwardDFT(spectrum,spectrum);
+}
+
+// Marks all of the derived outputs as needing recalculation
+void monogenicProcessor::invalidateOutputs()
+{
 	even_valid = false;
 	odd_valid = false;
 	even_mag_valid = false;
@@ -157,187 +438,2361 @@ void monogenicProcessor::findMonogenicSignal(const Mat &I)
 	lp_valid = false;
 }
 
-// Calculates and stores feature symmetry, and any dependencies if
-// necessary
-void monogenicProcessor::findSym()
+// This function is used to input a new image. The even and odd filter responses are found
+// via the DFT, and other images are invalidated.
+void monogenicProcessor::findMonogenicSignal(const Mat &I)
 {
-	Mat temp;
+	// The radial profile may be cheaper to apply recursively
+	if(use_recursive)
+	{
+		findMonogenicSignalRecursive(I);
+		return;
+	}
+	findMonogenicSignalExact(I);
+}
 
-	if(!amp_valid) findAmp();
+// Finds the responses via the DFT regardless of whether the recursive
+// approximation has been chosen
+void monogenicProcessor::findMonogenicSignalExact(const Mat &I)
+{
+	result_recursive = false;
 
-	temp = even_mag - odd_mag - T ;
-	threshold(temp,temp,0,0,THRESH_TOZERO);
-	sym = temp / (amp + C_EPSILON);
+	// Find the spectrum of the image, which is kept for later use (e.g. by
+	// registration) unless memory is short, in which case it is placed in the
+	// buffer of the odd response and multiplied in place
+	{
+		stageProfiler::scope timing(profiler,STAGE_INPUT);
+		if(memory_strategies & MEMORY_DROP_SPECTRUM)
+		{
+			im_spectrum.release();
+			findSpectrum(I,odd_im_cmplx);
+		}
+		else
+			findSpectrum(I,im_spectrum);
+	}
 
-	sym_valid = true;
+	// Multiply by each of the filters and take the inverse DFTs
+	applyFilters();
+
+	// Set all flags to false
+	invalidateOutputs();
+
+	// Update any temporally smoothed outputs
+	if(!temporal_outputs.empty())
+		updateTemporalState();
+
+	if(metrics)
+		recordFrameMetrics();
 }
 
-// Calculates and stores feature asymmetry, and any dependencies if
-// necessary
-void monogenicProcessor::findAsym()
+// Finds the responses of the even and odd filters, and any extra filters,
+// from the spectrum of the image
+void monogenicProcessor::applyFilters()
 {
-	Mat temp;
+	stageProfiler::scope timing(profiler,STAGE_FILTERING);
 
-	if(!amp_valid) findAmp();
+	const bool in_place = (memory_strategies & MEMORY_DROP_SPECTRUM) != 0;
+	const Mat &spectrum = in_place ? odd_im_cmplx : im_spectrum;
+	const int n_jobs = 2 + spectral_filters.size();
 
-	temp = odd_mag - even_mag - T ;
-	threshold(temp,temp,0,0,THRESH_TOZERO);
-	asym = temp / (amp + C_EPSILON);
+	if(latency_mode || in_place || !even_gain_half.empty())
+	{
+		// Multiply by all the filters in a single parallel pass over the
+		// spectrum, then take the inverse DFTs. In latency mode, these are
+		// taken in turn with the passes of each split across the threads
+		vector<Mat*> responses(n_jobs);
+		for(int k = 0; k < n_jobs; ++k)
+			responses[k] = (k == 0) ? &even_im_cmplx : ((k == 1) ? &odd_im_cmplx : &spectral_results[k-2]);
+		multiplyFilters(spectrum,responses);
 
-	asym_valid = true;
+		if(latency_mode)
+		{
+			for(int k = 0; k < n_jobs; ++k)
+				inverseDFT(*responses[k],*responses[k],true);
+		}
+		else
+		{
+			#pragma omp parallel for schedule(dynamic)
+			for(int k = 0; k < n_jobs; ++k)
+				inverseDFT(*responses[k],*responses[k],true);
+		}
+	}
+	else
+	{
+		// Perform odd and even calculations, and those for any extra filters,
+		// in parallel
+		#pragma omp parallel for schedule(dynamic)
+		for(int k = 0; k < n_jobs; ++k)
+		{
+			const Mat &filter = (k == 0) ? even_filter : ((k == 1) ? odd_filter : spectral_filters[k-2]);
+			Mat &response = (k == 0) ? even_im_cmplx : ((k == 1) ? odd_im_cmplx : spectral_results[k-2]);
+			mulSpectrums(im_spectrum,filter,response,0);
+			inverseDFT(response,response,true);
+		}
+	}
 }
 
-// Calculates and stores oriented feature symmetry, and any dependencies
-// if necessary
-void monogenicProcessor::findOrSym()
+// Multiplies the spectrum by the even and odd filters and any extra filters
+// in one pass. One of the responses may share the spectrum's buffer, in which
+// case each row of the spectrum is copied before it is overwritten. With half
+// precision filters, the odd filter is formed from the even gain as
+// -i.(w_x + i.w_y)/|w| times the gain (as in createLogGaborRieszFilt)
+void monogenicProcessor::multiplyFilters(const Mat &spectrum, const vector<Mat*> &responses)
 {
-	Mat temp;
+	const int n_jobs = responses.size();
+	bool aliased = false;
+	for(int k = 0; k < n_jobs; ++k)
+	{
+		responses[k]->create(pad_ysize,pad_xsize,CV_32FC2);
+		aliased = aliased || (responses[k]->data == spectrum.data);
+	}
 
-	if(!amp_valid) findAmp();
+	const bool half = !even_gain_half.empty();
+	const float xsizef = float(pad_xsize);
+	const float ysizef = float(pad_ysize);
+	const int xswitch = (pad_xsize % 2 == 0) ? pad_xsize/2 : (pad_xsize+1)/2;
+	const int yswitch = (pad_ysize % 2 == 0) ? pad_ysize/2 : (pad_ysize+1)/2;
 
-	// Positive symmetry
-	threshold(even_im,temp,0.0,0,THRESH_TOZERO);
-	temp = temp - odd_mag - T ;
-	threshold(temp,temp,0,0,THRESH_TOZERO);
-	pos_sym = temp / (amp + C_EPSILON);
+	#pragma omp parallel
+	{
+		vector<Vec2f> spec_copy(aliased ? pad_xsize : 0);
+		vector<float> gains(half ? pad_xsize : 0);
 
-	// Negative symmetry
-	threshold(-even_im,temp,0.0,0,THRESH_TOZERO);
-	temp = temp - odd_mag - T ;
-	threshold(temp,temp,0,0,THRESH_TOZERO);
-	neg_sym = temp / (amp + C_EPSILON);
+		#pragma omp for
+		for(int j = 0; j < pad_ysize; ++j)
+		{
+			const Vec2f* spec_ptr = spectrum.ptr<Vec2f>(j);
+			if(aliased)
+			{
+				std::copy(spec_ptr,spec_ptr + pad_xsize,spec_copy.begin());
+				spec_ptr = spec_copy.data();
+			}
+			if(half)
+				evenFilterRow(j,gains.data());
+			const float w_y = (j < yswitch) ? float(-j)/ysizef : (ysizef - float(j))/ysizef;
 
-	or_sym_valid = true;
+			for(int k = 0; k < n_jobs; ++k)
+			{
+				Vec2f* const resp_ptr = responses[k]->ptr<Vec2f>(j);
+				if(half && (k == 0))
+				{
+					for(int i = 0; i < pad_xsize; ++i)
+						resp_ptr[i] = Vec2f(gains[i]*spec_ptr[i][0],gains[i]*spec_ptr[i][1]);
+				}
+				else if(half && (k == 1))
+				{
+					for(int i = 0; i < pad_xsize; ++i)
+					{
+						const float w_x = (i < xswitch) ? float(i)/xsizef : (float(i)-xsizef)/xsizef;
+						const float w = std::sqrt(w_x*w_x + w_y*w_y);
+						const float scale = (w > 0.0f) ? gains[i]/w : 0.0f;
+						const float f_re = -w_y*scale, f_im = w_x*scale;
+						resp_ptr[i] = Vec2f(spec_ptr[i][0]*f_re - spec_ptr[i][1]*f_im,spec_ptr[i][0]*f_im + spec_ptr[i][1]*f_re);
+					}
+				}
+				else
+				{
+					const Mat &filter = (k == 0) ? even_filter : ((k == 1) ? odd_filter : spectral_filters[k-2]);
+					const Vec2f* const filt_ptr = filter.ptr<Vec2f>(j);
+					for(int i = 0; i < pad_xsize; ++i)
+					{
+						const float re = spec_ptr[i][0]*filt_ptr[i][0] - spec_ptr[i][1]*filt_ptr[i][1];
+						const float im = spec_ptr[i][0]*filt_ptr[i][1] + spec_ptr[i][1]*filt_ptr[i][0];
+						resp_ptr[i] = Vec2f(re,im);
+					}
+				}
+			}
+		}
+	}
 }
 
-// Split the even response into two planes (the imaginary plane can be
-// as it should be zero if not for numerical errors)
-void monogenicProcessor::splitEven()
+// Run a blank image through the full processing so that buffers are
+// allocated and paged in, and the OpenMP threads exist, before the first real
+// image. The blank image must not contribute to the temporal filter
+void monogenicProcessor::prepare(const vector<outputType> &outputs, const int input_type)
 {
-	Mat planes[2];
-	split(even_im_cmplx,planes);
-	even_im = planes[0];
-	even_valid = true;
+	// The blank image is not counted in the metrics, and its cold start
+	// timings are kept out of the stage statistics
+	std::shared_ptr<processorMetrics> saved_metrics;
+	saved_metrics.swap(metrics);
+	profiler.setSuspended(true);
+
+	const Mat blank = Mat::zeros(ysize,xsize,input_type);
+	findMonogenicSignal(blank);
+	for(size_t k = 0; k < outputs.size(); ++k)
+		findOutput(outputs[k]);
+
+	invalidateOutputs();
+	temporal_initialised = false;
+
+	profiler.setSuspended(false);
+	metrics = saved_metrics;
 }
 
-// Split the complex odd response into two planes (the two directions)
-// and store
-void monogenicProcessor::splitOdd()
+// Recursive approximation of the filter responses. The even part is the
+// difference of two recursively smoothed copies of the image, and the odd
+// part is its central difference derivative, scaled so that the response at
+// the centre frequency matches the Riesz transform
+void monogenicProcessor::findMonogenicSignalRecursive(const Mat &I)
 {
-	split(odd_im_cmplx,odd_ims);
-	odd_valid = true;
+	result_recursive = true;
+	{
+		stageProfiler::scope timing(profiler,STAGE_RECURSIVE);
+
+		findPadded(I,rec_smooth_1);
+
+		if(radial_profile)
+		{
+			if(!radial_profile->hasRecursiveImplementation())
+				CV_Error(cv::Error::StsNotImplemented,"The radial profile has no recursive implementation");
+			radial_profile->applyRecursive(rec_smooth_1);
+		}
+		else
+		{
+			if(!rec_fitted)
+			{
+				fitDoGToLogGabor(wl,sigma_onf,rec_sigma_1,rec_sigma_2,rec_gain,rec_profile_rms);
+				rec_fitted = true;
+			}
+
+			rec_smooth_1.copyTo(rec_smooth_2);
+
+			#pragma omp parallel sections
+			{
+				#pragma omp section
+				recursiveGaussian(rec_smooth_1,rec_sigma_1);
+				#pragma omp section
+				recursiveGaussian(rec_smooth_2,rec_sigma_2);
+			}
+
+			rec_smooth_1 = rec_gain*(rec_smooth_1 - rec_smooth_2);
+		}
+
+		// Band-pass image in the real part of the even response
+		const Mat rec_planes[2] = {rec_smooth_1,planes[1]};
+		merge(rec_planes,2,even_im_cmplx);
+
+		const float w_centre = radial_profile ? radial_profile->centreFrequency() : 1.0f/wl;
+		recursiveRiesz(even_im_cmplx,w_centre,odd_im_cmplx);
+	}
+
+	// There is no spectrum for this image, so nor are there responses to
+	// extra filters
+	im_spectrum.release();
+	for(size_t k = 0; k < spectral_results.size(); ++k)
+		spectral_results[k].release();
+
+	invalidateOutputs();
+
+	if(!temporal_outputs.empty())
+		updateTemporalState();
+
+	if(metrics)
+		recordFrameMetrics();
 }
 
-// Find and store the magnitude (absolute value) of the even filter
-// response
-void monogenicProcessor::findEvenMag()
+// Switch between splitting each image across the threads and the default
+// parallelism
+void monogenicProcessor::setLatencyMode(const bool enable)
 {
-	if(!even_valid) splitEven();
-	even_mag = cv::abs(even_im);
-	even_mag_valid = true;
+	latency_mode = enable;
+	transform.setParallel(enable);
 }
 
-// Find and store the magnitude and orientation of the odd filter
-void monogenicProcessor::findOddMagOri()
+void monogenicProcessor::setMetrics(const std::shared_ptr<processorMetrics> &processor_metrics)
 {
-	if(!odd_valid) splitOdd();
-	cartToPolar(odd_ims[0],odd_ims[1],odd_mag,ori);
-	odd_mag_ori_valid = true;
+	metrics = processor_metrics;
+	profiler.setMetrics(processor_metrics);
+	metrics_buffers.reserve(64);
 }
 
-// Find and store the local amplitude
-void monogenicProcessor::findAmp()
+// Count the image and update the memory held, which may change as outputs
+// are requested. This runs for every image, so the buffers are gathered into
+// a list whose storage is kept between images and sorted to find shared data,
+// rather than building the named list of getMemoryUsage
+void monogenicProcessor::recordFrameMetrics()
 {
-	if(!even_mag_valid) findEvenMag();
-	if(!odd_mag_ori_valid) findOddMagOri();
-	magnitude(odd_mag,even_mag,amp);
-	amp_valid = true;
+	metrics->recordFrame();
+
+	metrics_buffers.clear();
+	visitBuffers([this](const Mat &m, const char*, const int)
+	{
+		metrics_buffers.push_back(std::make_pair(m.datastart,size_t(m.dataend - m.datastart)));
+	});
+	std::sort(metrics_buffers.begin(),metrics_buffers.end());
+	size_t bytes = 0;
+	for(size_t k = 0; k < metrics_buffers.size(); ++k)
+		if((k == 0) || (metrics_buffers[k].first != metrics_buffers[k-1].first))
+			bytes += metrics_buffers[k].second;
+	metrics->setMemoryBytes(bytes);
 }
 
-// Find and store the local phase
-void monogenicProcessor::findLP()
+// Whether an output is available without further calculation
+bool monogenicProcessor::outputIsValid(const outputType output) const
 {
-	if(!odd_mag_ori_valid) findOddMagOri();
-	if(!even_valid) splitEven();
-	phase(even_im,odd_mag,lp);
-	lp_valid = true;
+	switch(output)
+	{
+		case OUTPUT_EVEN: return even_valid;
+		case OUTPUT_ODD_X: return odd_valid;
+		case OUTPUT_ODD_Y: return odd_valid;
+		case OUTPUT_ODD_MAG: return odd_mag_ori_valid;
+		case OUTPUT_ORIENTATION: return odd_mag_ori_valid;
+		case OUTPUT_AMPLITUDE: return amp_valid;
+		case OUTPUT_FS: return sym_valid;
+		case OUTPUT_FA: return asym_valid;
+		case OUTPUT_POS_FS: return or_sym_valid;
+		case OUTPUT_NEG_FS: return or_sym_valid;
+		case OUTPUT_LOCAL_PHASE: return lp_valid;
+	}
+	return false;
 }
 
-// (Calculates and) Returns the even filter response
-void monogenicProcessor::getEvenFilt(Mat &even)
+// Calls visit(m,name,index) for each buffer that is not empty, where index is
+// the position within a list of buffers, or -1
+template<typename visitor>
+void monogenicProcessor::visitBuffers(visitor visit) const
 {
-	if(!even_valid) splitEven();
-	even = even_im;
+	const Mat* const mats[] = {&even_im_cmplx,&odd_im_cmplx,&even_im,&odd_ims[0],&odd_ims[1],&even_mag,&odd_mag,&amp,&sym,&asym,&pos_sym,&neg_sym,&ori,&lp,
+		&even_filter,&odd_filter,&even_gain_half,&grad_even,&grad_odd,&planes[0],&planes[1],&im_spectrum,&reg_ref_spectrum,&reg_ref_log_polar,&reg_corr,&residual_im,&temporal_ori,&rec_smooth_1,&rec_smooth_2};
+	const char* const names[] = {"even_im_cmplx","odd_im_cmplx","even_im","odd_ims[0]","odd_ims[1]","even_mag","odd_mag","amp","sym","asym","pos_sym","neg_sym","ori","lp",
+		"even_filter","odd_filter","even_gain_half","grad_even","grad_odd","planes[0]","planes[1]","im_spectrum","reg_ref_spectrum","reg_ref_log_polar","reg_corr","residual_im","temporal_ori","rec_smooth_1","rec_smooth_2"};
+	const vector<Mat>* const mat_vectors[] = {&match_templ_spectra,&temporal_states,&spectral_filters,&spectral_results};
+	const char* const vector_names[] = {"match_templ_spectra","temporal_states","spectral_filters","spectral_results"};
+
+	for(size_t k = 0; k < sizeof(mats)/sizeof(mats[0]); ++k)
+		if(!mats[k]->empty())
+			visit(*mats[k],names[k],-1);
+	for(size_t v = 0; v < sizeof(mat_vectors)/sizeof(mat_vectors[0]); ++v)
+		for(size_t k = 0; k < mat_vectors[v]->size(); ++k)
+			if(!(*mat_vectors[v])[k].empty())
+				visit((*mat_vectors[v])[k],vector_names[v],int(k));
 }
 
-// (Calculates and) Returns the odd response as two separate images
-// (one for magnitude and the other for orientation)
-void monogenicProcessor::getOddFiltPolar(Mat &mag, Mat &lo)
+// Bytes held by each buffer. Buffers are identified by the start of their
+// allocation so that shared data is only counted once
+void monogenicProcessor::getMemoryUsage(vector<bufferUsage> &usage) const
 {
-	if(!odd_mag_ori_valid) findOddMagOri();
-	mag = odd_mag;
-	lo = ori;
+	usage.clear();
+	vector<const uchar*> seen;
+	visitBuffers([&](const Mat &m, const char *name, const int index)
+	{
+		if(std::find(seen.begin(),seen.end(),m.datastart) != seen.end())
+			return;
+		seen.push_back(m.datastart);
+		bufferUsage buffer;
+		buffer.name = (index < 0) ? string(name) : string(name) + "[" + std::to_string(index) + "]";
+		buffer.bytes = m.dataend - m.datastart;
+		usage.push_back(buffer);
+	});
 }
 
-// (Calculates and) Returns the odd response as two separate images
-// (one for each axis direction)
-void monogenicProcessor::getOddFiltCartesian(Mat &odd_y, Mat &odd_x)
+size_t monogenicProcessor::getMemoryUsage() const
 {
-	if(!odd_valid) splitOdd();
-	odd_y = odd_ims[1];
-	odd_x = odd_ims[0];
+	vector<bufferUsage> usage;
+	getMemoryUsage(usage);
+	size_t bytes = 0;
+	for(size_t k = 0; k < usage.size(); ++k)
+		bytes += usage[k].bytes;
+	return bytes;
 }
 
-// Returns the odd response as a single complex (two-channeled) image
-void monogenicProcessor::getOddFiltComplex(Mat &odd)
+void monogenicProcessor::setMemoryStrategies(const int strategies)
 {
-	odd = odd_im_cmplx;
+	const bool had_half_filters = (memory_strategies & MEMORY_HALF_FILTERS) != 0;
+	memory_strategies = strategies;
+
+	// Restore the full filters, or compact them
+	if(had_half_filters && !(strategies & MEMORY_HALF_FILTERS))
+	{
+		if(radial_profile)
+			createRadialRieszFilt(*radial_profile,even_filter,odd_filter);
+		else
+			createLogGaborRieszFilt(wl,even_filter,odd_filter);
+	}
+	compactFilters();
+
+	if(strategies & MEMORY_DROP_SPECTRUM)
+		im_spectrum.release();
+	if(strategies & MEMORY_FUSED_OUTPUTS)
+		trim(true);
 }
 
-// (Calculates and) Returns the feature symmetry
-void monogenicProcessor::getFeatureSymmetry(Mat &fs)
+int monogenicProcessor::getMemoryStrategies() const
 {
-	if(!sym_valid) findSym();
-	fs = sym;
+	return memory_strategies;
 }
 
-// (Calculates and) Returns the feature asymmetry
-void monogenicProcessor::getFeatureAsymmetry(Mat &fa)
+// The estimate counts the images of the padded size that are held between
+// images: the responses, filters, spectrum, input planes, extra filters and
+// temporal states, and the output images. Without fused outputs, requesting an
+// output also creates the intermediate images it depends on
+size_t monogenicProcessor::estimateMemoryUsage(const int strategies, const vector<outputType> &outputs) const
 {
-	if(!asym_valid) findAsym();
-	fa = asym;
-}
+	// Intermediate and output images (in units of single channel images)
+	enum { MAP_EVEN = 1, MAP_ODD = 2, MAP_EVEN_MAG = 4, MAP_ODD_MAG_ORI = 8, MAP_AMP = 16, MAP_SYM = 32, MAP_ASYM = 64, MAP_OR_SYM = 128, MAP_LP = 256 };
+	const int map_sizes[9] = {1,2,1,2,1,1,1,2,1};
+	const bool fused = (strategies & MEMORY_FUSED_OUTPUTS) || latency_mode;
+
+	int maps = 0;
+	for(size_t k = 0; k < outputs.size(); ++k)
+	{
+		const int amp_deps = fused ? (MAP_EVEN_MAG | MAP_ODD_MAG_ORI | MAP_AMP) : (MAP_EVEN | MAP_ODD | MAP_EVEN_MAG | MAP_ODD_MAG_ORI | MAP_AMP);
+		switch(outputs[k])
+		{
+			case OUTPUT_EVEN: maps |= MAP_EVEN; break;
+			case OUTPUT_ODD_X:
+			case OUTPUT_ODD_Y: maps |= MAP_ODD; break;
+			case OUTPUT_ODD_MAG:
+			case OUTPUT_ORIENTATION: maps |= fused ? MAP_ODD_MAG_ORI : (MAP_ODD | MAP_ODD_MAG_ORI); break;
+			case OUTPUT_AMPLITUDE: maps |= amp_deps; break;
+			case OUTPUT_FS: maps |= fused ? MAP_SYM : (amp_deps | MAP_SYM); break;
+			case OUTPUT_FA: maps |= fused ? MAP_ASYM : (amp_deps | MAP_ASYM); break;
+			case OUTPUT_POS_FS:
+			case OUTPUT_NEG_FS: maps |= fused ? MAP_OR_SYM : (amp_deps | MAP_OR_SYM); break;
+			case OUTPUT_LOCAL_PHASE: maps |= fused ? MAP_LP : (MAP_EVEN | MAP_ODD | MAP_ODD_MAG_ORI | MAP_LP); break;
+		}
+	}
+
+	size_t planes_f32 = 0;
+	for(int m = 0; m < 9; ++m)
+		if(maps & (1 << m)) planes_f32 += map_sizes[m];
+
+	// Responses, input planes and spectrum
+	planes_f32 += 4 + 2;
+	if(!(strategies & MEMORY_DROP_SPECTRUM))
+		planes_f32 += 2;
+
+	// Extra filters and their responses, and temporal states
+	planes_f32 += 4*spectral_filters.size();
+	for(size_t k = 0; k < temporal_outputs.size(); ++k)
+		planes_f32 += (temporal_outputs[k] == OUTPUT_ORIENTATION) ? 2 : 1;
+
+	const size_t plane_bytes = size_t(pad_ysize)*size_t(pad_xsize)*sizeof(float);
+	const size_t filter_bytes = (strategies & MEMORY_HALF_FILTERS) ? plane_bytes/2 : 4*plane_bytes;
+	return planes_f32*plane_bytes + filter_bytes;
+}
+
+bool monogenicProcessor::setMemoryBudget(const size_t bytes, const vector<outputType> &outputs)
+{
+	const int candidates[4] = {MEMORY_DEFAULT,MEMORY_FUSED_OUTPUTS,MEMORY_FUSED_OUTPUTS | MEMORY_HALF_FILTERS,MEMORY_FUSED_OUTPUTS | MEMORY_HALF_FILTERS | MEMORY_DROP_SPECTRUM};
+	for(int c = 0; c < 4; ++c)
+	{
+		if((estimateMemoryUsage(candidates[c],outputs) <= bytes) || (c == 3))
+		{
+			setMemoryStrategies(candidates[c]);
+			return estimateMemoryUsage(candidates[c],outputs) <= bytes;
+		}
+	}
+	return false;
+}
+
+// Release everything that can be recalculated from the responses (or, if
+// the result is not kept, from the next image)
+void monogenicProcessor::trim(const bool keep_result)
+{
+	Mat* const buffers[] = {&even_im,&odd_ims[0],&odd_ims[1],&even_mag,&odd_mag,&amp,&sym,&asym,&pos_sym,&neg_sym,&ori,&lp,
+		&planes[0],&reg_ref_log_polar,&reg_corr,&residual_im,&temporal_ori,&rec_smooth_1,&rec_smooth_2,&grad_even,&grad_odd};
+	for(size_t k = 0; k < sizeof(buffers)/sizeof(buffers[0]); ++k)
+		buffers[k]->release();
+	reg_ref_log_polar_valid = false;
+	invalidateOutputs();
+
+	if(!keep_result)
+	{
+		even_im_cmplx.release();
+		odd_im_cmplx.release();
+		im_spectrum.release();
+		for(size_t k = 0; k < spectral_results.size(); ++k)
+			spectral_results[k].release();
+	}
+}
+
+void monogenicProcessor::enableProfiling(const bool hardware_counters)
+{
+	profiler.enable(hardware_counters);
+}
+
+void monogenicProcessor::disableProfiling()
+{
+	profiler.disable();
+}
+
+void monogenicProcessor::getStageStatistics(vector<stageStatistics> &stats) const
+{
+	profiler.getStatistics(stats);
+}
+
+void monogenicProcessor::resetStageStatistics()
+{
+	profiler.reset();
+}
+
+// Compare the recursive approximation with the exact result over the
+// original image area
+void monogenicProcessor::validateRecursiveApproximation(const Mat &I, recursiveValidation &report)
+{
+	const Rect roi(0,0,xsize,ysize);
+	Mat approx_even, approx_odd, approx_fs, approx_fa, exact_fs, exact_fa;
+
+	findMonogenicSignalRecursive(I);
+	even_im_cmplx(roi).copyTo(approx_even);
+	odd_im_cmplx(roi).copyTo(approx_odd);
+	findOutput(OUTPUT_FS)(roi).copyTo(approx_fs);
+	findOutput(OUTPUT_FA)(roi).copyTo(approx_fa);
+
+	findMonogenicSignalExact(I);
+	exact_fs = findOutput(OUTPUT_FS)(roi);
+	exact_fa = findOutput(OUTPUT_FA)(roi);
+
+	const double n_pixels = double(xsize)*double(ysize);
+	report.profile_rms = radial_profile ? radial_profile->recursiveProfileError() : rec_profile_rms;
+	report.even_rel_rms = norm(approx_even,even_im_cmplx(roi)) / (norm(even_im_cmplx(roi)) + C_EPSILON);
+	report.odd_rel_rms = norm(approx_odd,odd_im_cmplx(roi)) / (norm(odd_im_cmplx(roi)) + C_EPSILON);
+	report.fs_mean_abs = norm(approx_fs,exact_fs,NORM_L1) / n_pixels;
+	report.fa_mean_abs = norm(approx_fa,exact_fa,NORM_L1) / n_pixels;
+}
+
+// Calculates and stores feature symmetry, and any dependencies if
+// necessary
+void monogenicProcessor::findSym()
+{
+	Mat temp;
+
+	if(!amp_valid) findAmp();
+	stageProfiler::scope timing(profiler,STAGE_SYMMETRY);
+
+	temp = even_mag - odd_mag - T ;
+	threshold(temp,temp,0,0,THRESH_TOZERO);
+	sym = temp / (amp + C_EPSILON);
+
+	sym_valid = true;
+}
+
+// Calculates and stores feature asymmetry, and any dependencies if
+// necessary
+void monogenicProcessor::findAsym()
+{
+	Mat temp;
+
+	if(!amp_valid) findAmp();
+	stageProfiler::scope timing(profiler,STAGE_SYMMETRY);
+
+	temp = odd_mag - even_mag - T ;
+	threshold(temp,temp,0,0,THRESH_TOZERO);
+	asym = temp / (amp + C_EPSILON);
+
+	asym_valid = true;
+}
+
+// Calculates and stores oriented feature symmetry, and any dependencies
+// if necessary
+void monogenicProcessor::findOrSym()
+{
+	Mat temp;
+
+	if(!amp_valid) findAmp();
+	stageProfiler::scope timing(profiler,STAGE_ORIENTED_SYMMETRY);
+
+	// Positive symmetry
+	threshold(even_im,temp,0.0,0,THRESH_TOZERO);
+	temp = temp - odd_mag - T ;
+	threshold(temp,temp,0,0,THRESH_TOZERO);
+	pos_sym = temp / (amp + C_EPSILON);
+
+	// Negative symmetry
+	threshold(-even_im,temp,0.0,0,THRESH_TOZERO);
+	temp = temp - odd_mag - T ;
+	threshold(temp,temp,0,0,THRESH_TOZERO);
+	neg_sym = temp / (amp + C_EPSILON);
+
+	or_sym_valid = true;
+}
+
+// Split the even response into two planes (the imaginary plane can be
+// as it should be zero if not for numerical errors)
+void monogenicProcessor::splitEven()
+{
+	stageProfiler::scope timing(profiler,STAGE_SPLIT);
+	Mat planes[2];
+	split(even_im_cmplx,planes);
+	even_im = planes[0];
+	even_valid = true;
+}
+
+// Split the complex odd response into two planes (the two directions)
+// and store
+void monogenicProcessor::splitOdd()
+{
+	stageProfiler::scope timing(profiler,STAGE_SPLIT);
+	split(odd_im_cmplx,odd_ims);
+	odd_valid = true;
+}
+
+// Find and store the magnitude (absolute value) of the even filter
+// response
+void monogenicProcessor::findEvenMag()
+{
+	if(!even_valid) splitEven();
+	stageProfiler::scope timing(profiler,STAGE_MAGNITUDES);
+	even_mag = cv::abs(even_im);
+	even_mag_valid = true;
+}
+
+// Find and store the magnitude and orientation of the odd filter
+void monogenicProcessor::findOddMagOri()
+{
+	if(!odd_valid) splitOdd();
+	stageProfiler::scope timing(profiler,STAGE_MAGNITUDES);
+	cartToPolar(odd_ims[0],odd_ims[1],odd_mag,ori);
+	odd_mag_ori_valid = true;
+}
+
+// Find and store the local amplitude
+void monogenicProcessor::findAmp()
+{
+	if(!even_mag_valid) findEvenMag();
+	if(!odd_mag_ori_valid) findOddMagOri();
+	stageProfiler::scope timing(profiler,STAGE_AMPLITUDE);
+	magnitude(odd_mag,even_mag,amp);
+	amp_valid = true;
+}
+
+// Find and store the local phase
+void monogenicProcessor::findLP()
+{
+	if(!odd_mag_ori_valid) findOddMagOri();
+	if(!even_valid) splitEven();
+	stageProfiler::scope timing(profiler,STAGE_LOCAL_PHASE);
+	phase(even_im,odd_mag,lp);
+	lp_valid = true;
+}
+
+// (Calculates and) Returns the even filter response
+void monogenicProcessor::getEvenFilt(Mat &even)
+{
+	even = findOutput(OUTPUT_EVEN);
+}
+
+// (Calculates and) Returns the odd response as two separate images
+// (one for magnitude and the other for orientation)
+void monogenicProcessor::getOddFiltPolar(Mat &mag, Mat &lo)
+{
+	mag = findOutput(OUTPUT_ODD_MAG);
+	lo = findOutput(OUTPUT_ORIENTATION);
+}
+
+// (Calculates and) Returns the odd response as two separate images
+// (one for each axis direction)
+void monogenicProcessor::getOddFiltCartesian(Mat &odd_y, Mat &odd_x)
+{
+	odd_y = findOutput(OUTPUT_ODD_Y);
+	odd_x = findOutput(OUTPUT_ODD_X);
+}
+
+// Returns the odd response as a single complex (two-channeled) image
+void monogenicProcessor::getOddFiltComplex(Mat &odd)
+{
+	odd = odd_im_cmplx;
+}
+
+// (Calculates and) Returns the feature symmetry
+void monogenicProcessor::getFeatureSymmetry(Mat &fs)
+{
+	fs = findOutput(OUTPUT_FS);
+}
+
+// (Calculates and) Returns the feature asymmetry
+void monogenicProcessor::getFeatureAsymmetry(Mat &fa)
+{
+	fa = findOutput(OUTPUT_FA);
+}
 
 // (Calculates and) Returns the oriented symmetry as two separate images
 // (one for positive symmetry and the other for negative symmetry)
 void monogenicProcessor::getSignedSymmetry(Mat &pos_fs, Mat &neg_fs)
 {
-	if(!or_sym_valid) findOrSym();
-	pos_fs = pos_sym;
-	neg_fs = neg_sym;
+	pos_fs = findOutput(OUTPUT_POS_FS);
+	neg_fs = findOutput(OUTPUT_NEG_FS);
 }
 
 // (Calculates and) Returns the oriented asymmetry as two separate images
 // (one for magnitude and the other for orientation)
 void monogenicProcessor::getOrientedAsymmetry(Mat &fa, Mat &lo)
 {
-	if(!asym_valid) findAsym();
-	fa = asym;
-	lo = ori;
+	fa = findOutput(OUTPUT_FA);
+	lo = findOutput(OUTPUT_ORIENTATION);
 }
 
 
 void monogenicProcessor::getLocalPhase(Mat &lp)
 {
-	if(!lp_valid) findLP();
-	lp = this->lp;
+	lp = findOutput(OUTPUT_LOCAL_PHASE);
 }
 
 void monogenicProcessor::getLocalPhaseVector(Mat &mag, Mat &lo)
 {
-	if(!lp_valid) findLP();
-	mag = lp;
-	lo = ori;
+	mag = findOutput(OUTPUT_LOCAL_PHASE);
+	lo = findOutput(OUTPUT_ORIENTATION);
+}
+
+// Size of the padded images
+Size monogenicProcessor::getTransformSize() const
+{
+	return Size(pad_xsize,pad_ysize);
+}
+
+// Store an extra filter in complex form ready for mulSpectrums
+int monogenicProcessor::addSpectralFilter(const Mat &filter)
+{
+	if((filter.rows != pad_ysize) || (filter.cols != pad_xsize) || ((filter.type() != CV_32F) && (filter.type() != CV_32FC2)))
+		CV_Error(cv::Error::StsBadArg,"Spectral filters must be CV_32F or CV_32FC2 and of the transform size");
+
+	Mat complex_filter;
+	if(filter.type() == CV_32F)
+	{
+		const Mat filter_planes[2] = {filter,planes[1]};
+		merge(filter_planes,2,complex_filter);
+	}
+	else
+		complex_filter = filter.clone();
+
+	spectral_filters.push_back(complex_filter);
+	spectral_results.push_back(Mat());
+	return int(spectral_filters.size()) - 1;
+}
+
+// Create and store a filter from a radial profile
+int monogenicProcessor::addSpectralFilter(const radialProfile &profile)
+{
+	Mat even_filt, odd_filt;
+	createRadialRieszFilt(profile,even_filt,odd_filt);
+	spectral_filters.push_back(even_filt);
+	spectral_results.push_back(Mat());
+	return int(spectral_filters.size()) - 1;
+}
+
+// Forget all extra filters
+void monogenicProcessor::clearSpectralFilters()
+{
+	spectral_filters.clear();
+	spectral_results.clear();
+}
+
+// Returns the response to an extra filter
+void monogenicProcessor::getSpectralFilterResult(const int id, Mat &result)
+{
+	if((id < 0) || (id >= int(spectral_results.size())) || spectral_results[id].empty())
+		CV_Error(cv::Error::StsBadArg,"No response is available for this spectral filter");
+	result = spectral_results[id];
+}
+
+// Calculates (if necessary) and returns a reference to one of the outputs
+const Mat& monogenicProcessor::findOutput(const outputType output)
+{
+	if(even_im_cmplx.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+
+	if(metrics)
+		metrics->recordCacheAccess(outputIsValid(output));
+
+	if(latency_mode || (memory_strategies & MEMORY_FUSED_OUTPUTS))
+		findOutputParallel(output);
+
+	switch(output)
+	{
+		case OUTPUT_EVEN:
+			if(!even_valid) splitEven();
+			return even_im;
+		case OUTPUT_ODD_X:
+			if(!odd_valid) splitOdd();
+			return odd_ims[0];
+		case OUTPUT_ODD_Y:
+			if(!odd_valid) splitOdd();
+			return odd_ims[1];
+		case OUTPUT_ODD_MAG:
+			if(!odd_mag_ori_valid) findOddMagOri();
+			return odd_mag;
+		case OUTPUT_ORIENTATION:
+			if(!odd_mag_ori_valid) findOddMagOri();
+			return ori;
+		case OUTPUT_AMPLITUDE:
+			if(!amp_valid) findAmp();
+			return amp;
+		case OUTPUT_FS:
+			if(!sym_valid) findSym();
+			return sym;
+		case OUTPUT_FA:
+			if(!asym_valid) findAsym();
+			return asym;
+		case OUTPUT_POS_FS:
+			if(!or_sym_valid) findOrSym();
+			return pos_sym;
+		case OUTPUT_NEG_FS:
+			if(!or_sym_valid) findOrSym();
+			return neg_sym;
+		case OUTPUT_LOCAL_PHASE:
+			if(!lp_valid) findLP();
+			return lp;
+	}
+	CV_Error(cv::Error::StsBadArg,"Unknown output type");
+}
+
+// Latency mode (and low memory) version of the calculation of outputs. Rather than chaining the
+// intermediate images, each output (and any others whose validity flags it
+// shares) is found directly from the filter responses in one parallel pass.
+// The amplitude also sets the magnitudes that the symmetry calculations
+// assume are valid along with it
+void monogenicProcessor::findOutputParallel(const outputType output)
+{
+	struct mapJob
+	{
+		outputType type;
+		Mat *map;
+		bool abs_even;    // the magnitude of the even part instead of type
+	};
+	mapJob jobs[4];
+	int n_jobs = 0;
+	bool *flags[3] = {nullptr,nullptr,nullptr};
+
+	switch(output)
+	{
+		case OUTPUT_EVEN:
+			if(even_valid) return;
+			jobs[n_jobs++] = {OUTPUT_EVEN,&even_im,false};
+			flags[0] = &even_valid;
+			break;
+		case OUTPUT_ODD_X:
+		case OUTPUT_ODD_Y:
+			if(odd_valid) return;
+			jobs[n_jobs++] = {OUTPUT_ODD_X,&odd_ims[0],false};
+			jobs[n_jobs++] = {OUTPUT_ODD_Y,&odd_ims[1],false};
+			flags[0] = &odd_valid;
+			break;
+		case OUTPUT_ODD_MAG:
+		case OUTPUT_ORIENTATION:
+			if(odd_mag_ori_valid) return;
+			jobs[n_jobs++] = {OUTPUT_ODD_MAG,&odd_mag,false};
+			jobs[n_jobs++] = {OUTPUT_ORIENTATION,&ori,false};
+			flags[0] = &odd_mag_ori_valid;
+			break;
+		case OUTPUT_AMPLITUDE:
+			if(amp_valid) return;
+			jobs[n_jobs++] = {OUTPUT_EVEN,&even_mag,true};
+			jobs[n_jobs++] = {OUTPUT_ODD_MAG,&odd_mag,false};
+			jobs[n_jobs++] = {OUTPUT_ORIENTATION,&ori,false};
+			jobs[n_jobs++] = {OUTPUT_AMPLITUDE,&amp,false};
+			flags[0] = &even_mag_valid;
+			flags[1] = &odd_mag_ori_valid;
+			flags[2] = &amp_valid;
+			break;
+		case OUTPUT_FS:
+			if(sym_valid) return;
+			jobs[n_jobs++] = {OUTPUT_FS,&sym,false};
+			flags[0] = &sym_valid;
+			break;
+		case OUTPUT_FA:
+			if(asym_valid) return;
+			jobs[n_jobs++] = {OUTPUT_FA,&asym,false};
+			flags[0] = &asym_valid;
+			break;
+		case OUTPUT_POS_FS:
+		case OUTPUT_NEG_FS:
+			if(or_sym_valid) return;
+			jobs[n_jobs++] = {OUTPUT_POS_FS,&pos_sym,false};
+			jobs[n_jobs++] = {OUTPUT_NEG_FS,&neg_sym,false};
+			flags[0] = &or_sym_valid;
+			break;
+		case OUTPUT_LOCAL_PHASE:
+			if(lp_valid) return;
+			jobs[n_jobs++] = {OUTPUT_LOCAL_PHASE,&lp,false};
+			flags[0] = &lp_valid;
+			break;
+	}
+
+	stageProfiler::scope timing(profiler,STAGE_FUSED_OUTPUTS);
+	for(int k = 0; k < n_jobs; ++k)
+		jobs[k].map->create(pad_ysize,pad_xsize,CV_32F);
+
+	#pragma omp parallel for
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+		const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+		for(int k = 0; k < n_jobs; ++k)
+		{
+			float* const map_ptr = jobs[k].map->ptr<float>(j);
+			if(jobs[k].abs_even)
+			{
+				for(int i = 0; i < pad_xsize; ++i)
+					map_ptr[i] = std::abs(even_ptr[i][0]);
+			}
+			else
+			{
+				for(int i = 0; i < pad_xsize; ++i)
+					map_ptr[i] = pixelOutput(jobs[k].type,even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+			}
+		}
+	}
+
+	for(int f = 0; f < 3; ++f)
+		if(flags[f] != nullptr) *flags[f] = true;
+}
+
+// Calculates any of the outputs at a single pixel directly from the even
+// response and the two components of the odd response. This is used by the
+// fused kernels, which avoid storing full intermediate images
+float monogenicProcessor::pixelOutput(const outputType output, const float e, const float o_x, const float o_y, const float T)
+{
+	switch(output)
+	{
+		case OUTPUT_EVEN:
+			return e;
+		case OUTPUT_ODD_X:
+			return o_x;
+		case OUTPUT_ODD_Y:
+			return o_y;
+		default:
+			break;
+	}
+
+	const float o_mag = std::sqrt(o_x*o_x + o_y*o_y);
+	switch(output)
+	{
+		case OUTPUT_ODD_MAG:
+			return o_mag;
+		case OUTPUT_ORIENTATION:
+		{
+			const float angle = std::atan2(o_y,o_x);
+			return (angle < 0.0f) ? angle + 2.0f*float(CV_PI) : angle;
+		}
+		case OUTPUT_LOCAL_PHASE:
+			return std::atan2(o_mag,e);
+		default:
+			break;
+	}
+
+	const float a = std::sqrt(e*e + o_mag*o_mag);
+	switch(output)
+	{
+		case OUTPUT_AMPLITUDE:
+			return a;
+		case OUTPUT_FS:
+			return std::max(std::abs(e) - o_mag - T,0.0f) / (a + C_EPSILON);
+		case OUTPUT_FA:
+			return std::max(o_mag - std::abs(e) - T,0.0f) / (a + C_EPSILON);
+		case OUTPUT_POS_FS:
+			return std::max(std::max(e,0.0f) - o_mag - T,0.0f) / (a + C_EPSILON);
+		case OUTPUT_NEG_FS:
+			return std::max(std::max(-e,0.0f) - o_mag - T,0.0f) / (a + C_EPSILON);
+		default:
+			break;
+	}
+	return 0.0f;
+}
+
+// Partial derivatives of pixelOutput with respect to the even response and
+// the two components of the odd response. For the symmetry measures, with
+// numerator N (zero where negative) and denominator D = a + epsilon, the
+// derivative is dN/D - N.dD/D^2, where the magnitude of the odd part and the
+// amplitude are differentiated through the components
+void monogenicProcessor::pixelOutputGradient(const outputType output, const float e, const float o_x, const float o_y, const float T, float &d_e, float &d_x, float &d_y)
+{
+	d_e = 0.0f;
+	d_x = 0.0f;
+	d_y = 0.0f;
+	const float o_mag = std::sqrt(o_x*o_x + o_y*o_y);
+	const float a = std::sqrt(e*e + o_mag*o_mag);
+
+	// Derivatives with respect to the even part and the odd magnitude, for
+	// the outputs that depend on the odd part through its magnitude only
+	float d_mag = 0.0f;
+
+	switch(output)
+	{
+		case OUTPUT_EVEN:
+			d_e = 1.0f;
+			return;
+		case OUTPUT_ODD_X:
+			d_x = 1.0f;
+			return;
+		case OUTPUT_ODD_Y:
+			d_y = 1.0f;
+			return;
+		case OUTPUT_ORIENTATION:
+			if(o_mag > 0.0f)
+			{
+				d_x = -o_y/(o_mag*o_mag);
+				d_y = o_x/(o_mag*o_mag);
+			}
+			return;
+		case OUTPUT_ODD_MAG:
+			d_mag = 1.0f;
+			break;
+		case OUTPUT_AMPLITUDE:
+			if(a > 0.0f)
+			{
+				d_e = e/a;
+				d_mag = o_mag/a;
+			}
+			break;
+		case OUTPUT_LOCAL_PHASE:
+			if(a > 0.0f)
+			{
+				d_e = -o_mag/(a*a);
+				d_mag = e/(a*a);
+			}
+			break;
+		case OUTPUT_FS:
+		case OUTPUT_FA:
+		case OUTPUT_POS_FS:
+		case OUTPUT_NEG_FS:
+		{
+			// Derivatives of the numerator before thresholding
+			float num, dn_e, dn_mag;
+			const float sign_e = (e > 0.0f) ? 1.0f : ((e < 0.0f) ? -1.0f : 0.0f);
+			switch(output)
+			{
+				case OUTPUT_FS:
+					num = std::abs(e) - o_mag - T;
+					dn_e = sign_e;
+					dn_mag = -1.0f;
+					break;
+				case OUTPUT_FA:
+					num = o_mag - std::abs(e) - T;
+					dn_e = -sign_e;
+					dn_mag = 1.0f;
+					break;
+				case OUTPUT_POS_FS:
+					num = std::max(e,0.0f) - o_mag - T;
+					dn_e = (e > 0.0f) ? 1.0f : 0.0f;
+					dn_mag = -1.0f;
+					break;
+				default:
+					num = std::max(-e,0.0f) - o_mag - T;
+					dn_e = (e < 0.0f) ? -1.0f : 0.0f;
+					dn_mag = -1.0f;
+					break;
+			}
+			if((num <= 0.0f) || (a <= 0.0f))
+				return;
+			const float denom = a + C_EPSILON;
+			const float ratio = num/(denom*denom*a);
+			d_e = dn_e/denom - ratio*e;
+			d_mag = dn_mag/denom - ratio*o_mag;
+			break;
+		}
+	}
+
+	if(o_mag > 0.0f)
+	{
+		d_x = d_mag*o_x/o_mag;
+		d_y = d_mag*o_y/o_mag;
+	}
+}
+
+// (Calculates and) Returns any of the outputs
+void monogenicProcessor::getOutput(const outputType output, Mat &result)
+{
+	result = findOutput(output);
+}
+
+// Normalise a template, and store its spectrum at the padded image size ready
+// for correlation. The spectrum is stored as is, and is conjugated by
+// mulSpectrums when the templates are matched
+int monogenicProcessor::addMatchTemplate(const Mat &templ, const outputType output)
+{
+	if((templ.channels() != 1) || (templ.rows > ysize) || (templ.cols > xsize) || templ.empty())
+		CV_Error(cv::Error::StsBadSize,"Templates must be single channel and no larger than the image");
+
+	// Zero-mean and unit-norm template in the top left corner of a padded image
+	Mat templ_planes[2], templ_spectrum;
+	templ_planes[0] = Mat::zeros(pad_ysize,pad_xsize,CV_32F);
+	templ_planes[1] = Mat::zeros(pad_ysize,pad_xsize,CV_32F);
+	Mat roi = templ_planes[0](Rect(0,0,templ.cols,templ.rows));
+	templ.convertTo(roi,CV_32F);
+	roi -= mean(roi);
+	const double templ_norm = norm(roi);
+	if(templ_norm > 0.0)
+		roi /= templ_norm;
+
+	merge(templ_planes,2,templ_spectrum);
+	forwardDFT(templ_spectrum,templ_spectrum);
+
+	match_templ_spectra.push_back(templ_spectrum);
+	match_templ_outputs.push_back(output);
+	match_templ_sizes.push_back(templ.size());
+	return int(match_templ_spectra.size()) - 1;
+}
+
+// Forget all templates
+void monogenicProcessor::clearMatchTemplates()
+{
+	match_templ_spectra.clear();
+	match_templ_outputs.clear();
+	match_templ_sizes.clear();
+}
+
+// Correlate each template with its output map in the frequency domain, and
+// extract the strongest peaks
+void monogenicProcessor::findTemplateMatches(vector<templateMatch> &matches, const int max_matches, const float min_score, const int min_separation)
+{
+	const int n_templates = match_templ_spectra.size();
+	vector<bool> done(n_templates,false);
+	vector<templateMatch> candidates;
+	Mat map_planes[2], map_spectrum, corr;
+
+	matches.clear();
+
+	for(int t = 0; t < n_templates; ++t)
+	{
+		if(done[t]) continue;
+
+		// Transform the output map once for all templates that use it
+		map_planes[0] = findOutput(match_templ_outputs[t]);
+		map_planes[1] = planes[1];
+		merge(map_planes,2,map_spectrum);
+		forwardDFT(map_spectrum,map_spectrum);
+
+		for(int u = t; u < n_templates; ++u)
+		{
+			if(match_templ_outputs[u] != match_templ_outputs[t]) continue;
+			done[u] = true;
+
+			mulSpectrums(map_spectrum,match_templ_spectra[u],corr,0,true);
+			inverseDFT(corr,corr,true);
+
+			// Find local maxima at positions where the template lies
+			// entirely within the image
+			const int last_y = ysize - match_templ_sizes[u].height;
+			const int last_x = xsize - match_templ_sizes[u].width;
+			candidates.clear();
+			for(int j = 0; j <= last_y; ++j)
+			{
+				const Vec2f* const prev_ptr = corr.ptr<Vec2f>(std::max(j-1,0));
+				const Vec2f* const corr_ptr = corr.ptr<Vec2f>(j);
+				const Vec2f* const next_ptr = corr.ptr<Vec2f>(std::min(j+1,pad_ysize-1));
+				for(int i = 0; i <= last_x; ++i)
+				{
+					const float v = corr_ptr[i][0];
+					if(v <= min_score) continue;
+					const int il = std::max(i-1,0), ir = std::min(i+1,pad_xsize-1);
+					if((v < corr_ptr[il][0]) || (v < corr_ptr[ir][0])
+						|| (v < prev_ptr[il][0]) || (v < prev_ptr[i][0]) || (v < prev_ptr[ir][0])
+						|| (v < next_ptr[il][0]) || (v < next_ptr[i][0]) || (v < next_ptr[ir][0]))
+						continue;
+					templateMatch m;
+					m.template_id = u;
+					m.location = Point(i,j);
+					m.score = v;
+					candidates.push_back(m);
+				}
+			}
+
+			// Greedily accept the strongest peaks that are not too close to
+			// an already accepted peak
+			sort(candidates.begin(),candidates.end(),[](const templateMatch &a, const templateMatch &b){ return a.score > b.score; });
+			const size_t first_accepted = matches.size();
+			for(const templateMatch &c : candidates)
+			{
+				if(int(matches.size() - first_accepted) >= max_matches) break;
+				bool suppressed = false;
+				for(size_t k = first_accepted; k < matches.size(); ++k)
+				{
+					if((std::abs(matches[k].location.x - c.location.x) < min_separation)
+						&& (std::abs(matches[k].location.y - c.location.y) < min_separation))
+					{
+						suppressed = true;
+						break;
+					}
+				}
+				if(!suppressed)
+					matches.push_back(c);
+			}
+		}
+	}
+}
+
+// Denoise by amplitude shrinkage. The image is the sum of its band-pass part
+// (the even response) and the residual outside the band, F.(1 - H_even).
+// The residual is found with one inverse DFT, and the shrinkage gain, which
+// depends on the local amplitude of the full monogenic signal, is applied to
+// the even response in the same pass that recombines the two
+void monogenicProcessor::getDenoised(Mat &denoised, const float amp_thresh, const bool soft)
+{
+	// Both the responses and the spectrum of the same image are needed. The
+	// spectrum is not kept with MEMORY_DROP_SPECTRUM or by the recursive
+	// approximation
+	if(even_im_cmplx.empty() || odd_im_cmplx.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+	if(im_spectrum.empty())
+		CV_Error(cv::Error::StsNotImplemented,"Denoising needs the spectrum of the image, which is not kept with MEMORY_DROP_SPECTRUM or by findMonogenicSignalRecursive");
+
+	residual_im.create(pad_ysize,pad_xsize,CV_32FC2);
+
+	#pragma omp parallel
+	{
+		vector<float> gains(pad_xsize);
+
+		#pragma omp for
+		for(int j = 0; j < pad_ysize; ++j)
+		{
+			const Vec2f* const spec_ptr = im_spectrum.ptr<Vec2f>(j);
+			Vec2f* const res_ptr = residual_im.ptr<Vec2f>(j);
+			evenFilterRow(j,gains.data());
+			for(int i = 0; i < pad_xsize; ++i)
+			{
+				const float g = 1.0f - gains[i];
+				res_ptr[i][0] = g*spec_ptr[i][0];
+				res_ptr[i][1] = g*spec_ptr[i][1];
+			}
+		}
+	}
+
+	inverseDFT(residual_im,residual_im,true);
+
+	denoised.create(pad_ysize,pad_xsize,CV_32F);
+
+	#pragma omp parallel for
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2f* const res_ptr = residual_im.ptr<Vec2f>(j);
+		const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+		const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+		float* const out_ptr = denoised.ptr<float>(j);
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			const float e = even_ptr[i][0];
+			const float a = std::sqrt(e*e + odd_ptr[i][0]*odd_ptr[i][0] + odd_ptr[i][1]*odd_ptr[i][1]);
+			float gain;
+			if(soft)
+				gain = (a > amp_thresh) ? (a - amp_thresh)/a : 0.0f;
+			else
+				gain = (a > amp_thresh) ? 1.0f : 0.0f;
+			out_ptr[i] = res_ptr[i][0] + gain*e;
+		}
+	}
+}
+
+// Edge extraction from feature asymmetry. Rows of feature asymmetry are
+// calculated into a three-row ring buffer as they are needed, so that non-
+// maximum suppression along the local orientation runs while the rows are
+// in cache. Candidates surviving suppression are joined with their already
+// visited 8-connected neighbours in a union-find forest that records whether
+// each connected component contains a strong pixel, which implements
+// hysteresis without a second pass over the image
+void monogenicProcessor::getEdgels(vector<edgel> &edgels, const float low_thresh, const float high_thresh)
+{
+	if(even_im_cmplx.empty() || odd_im_cmplx.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+
+	edgels.clear();
+	if((ysize < 3) || (xsize < 3)) return;
+
+	Mat fa_rows(3,xsize,CV_32F);
+	vector<edgel> candidates;
+	vector<int> parent, prev_labels(xsize,-1), cur_labels(xsize,-1);
+	vector<char> strong;
+
+	auto findFARow = [&](const int j)
+	{
+		const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+		const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+		float* const fa_ptr = fa_rows.ptr<float>(j % 3);
+		for(int i = 0; i < xsize; ++i)
+			fa_ptr[i] = pixelOutput(OUTPUT_FA,even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+	};
+
+	auto findRoot = [&](int n)
+	{
+		while(parent[n] != n)
+		{
+			parent[n] = parent[parent[n]];
+			n = parent[n];
+		}
+		return n;
+	};
+
+	auto join = [&](int a, int b)
+	{
+		a = findRoot(a);
+		b = findRoot(b);
+		if(a == b) return;
+		if(b < a) std::swap(a,b);
+		parent[b] = a;
+		strong[a] = strong[a] || strong[b];
+	};
+
+	findFARow(0);
+	findFARow(1);
+	for(int j = 1; j < ysize - 1; ++j)
+	{
+		findFARow(j+1);
+		const float* const fa_ptrs[3] = {fa_rows.ptr<float>((j-1) % 3), fa_rows.ptr<float>(j % 3), fa_rows.ptr<float>((j+1) % 3)};
+		const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+		const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+
+		std::swap(prev_labels,cur_labels);
+		std::fill(cur_labels.begin(),cur_labels.end(),-1);
+
+		for(int i = 1; i < xsize - 1; ++i)
+		{
+			const float v = fa_ptrs[1][i];
+			if((v < low_thresh) || (v <= 0.0f)) continue;
+
+			// Quantise the direction of the odd vector (whose y component
+			// points up the image) to one of the eight neighbours
+			const float dx = odd_ptr[i][0], dy = -odd_ptr[i][1];
+			int sx, sy;
+			if(std::abs(dx) > 2.4142f*std::abs(dy))
+			{
+				sx = 1;
+				sy = 0;
+			}
+			else if(std::abs(dy) > 2.4142f*std::abs(dx))
+			{
+				sx = 0;
+				sy = 1;
+			}
+			else
+			{
+				sx = (dx > 0.0f) ? 1 : -1;
+				sy = (dy > 0.0f) ? 1 : -1;
+			}
+
+			// Non-maximum suppression (ties are broken towards the first
+			// pixel so that plateaus produce a single edge)
+			const float before = fa_ptrs[1-sy][i-sx];
+			const float after = fa_ptrs[1+sy][i+sx];
+			if((v < before) || (v <= after)) continue;
+
+			// Subpixel position along the direction from a parabola fit
+			const float denom = before - 2.0f*v + after;
+			const float t = (denom < 0.0f) ? 0.5f*(before - after)/denom : 0.0f;
+
+			edgel e;
+			e.position = Point2f(float(i) + t*float(sx),float(j) + t*float(sy));
+			e.orientation = pixelOutput(OUTPUT_ORIENTATION,even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+			e.strength = v;
+
+			const int id = candidates.size();
+			candidates.push_back(e);
+			parent.push_back(id);
+			strong.push_back(v >= high_thresh);
+			cur_labels[i] = id;
+
+			// Link to the previously visited neighbours
+			if(cur_labels[i-1] >= 0) join(id,cur_labels[i-1]);
+			for(int k = i-1; k <= i+1; ++k)
+				if(prev_labels[k] >= 0) join(id,prev_labels[k]);
+		}
+	}
+
+	// Keep candidates in components that contain a strong pixel
+	for(int n = 0; n < int(candidates.size()); ++n)
+		if(strong[findRoot(n)])
+			edgels.push_back(candidates[n]);
+}
+
+// Multiplies the stored spectrum by a log Gabor filter of the given
+// wavelength and its Riesz transform (as in createLogGaborRieszFilt), forming
+// the filter values as it goes so that no filter images are needed
+void monogenicProcessor::filterSpectrumLogGabor(const float wavelength, Mat &even_resp, Mat &odd_resp) const
+{
+	const float w0 = 1.0f/wavelength;
+	const float scale_const = 1.0/(2.0*std::log(sigma_onf)*std::log(sigma_onf));
+	const float xsizef = float(pad_xsize);
+	const float ysizef = float(pad_ysize);
+	const int xswitch = (pad_xsize % 2 == 0) ? pad_xsize/2 : (pad_xsize+1)/2;
+	const int yswitch = (pad_ysize % 2 == 0) ? pad_ysize/2 : (pad_ysize+1)/2;
+
+	even_resp.create(pad_ysize,pad_xsize,CV_32FC2);
+	odd_resp.create(pad_ysize,pad_xsize,CV_32FC2);
+
+	#pragma omp parallel for
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2f* const spec_ptr = im_spectrum.ptr<Vec2f>(j);
+		Vec2f* const even_ptr = even_resp.ptr<Vec2f>(j);
+		Vec2f* const odd_ptr = odd_resp.ptr<Vec2f>(j);
+		const float w_y = (j < yswitch) ? float(-j)/ysizef : (ysizef - float(j))/ysizef;
+		const bool zero_row = (pad_ysize % 2 == 0) && (j == yswitch);
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			// The DC and unpaired highest frequency components are zeroed
+			if(zero_row || ((i == 0) && (j == 0)) || ((pad_xsize % 2 == 0) && (i == xswitch)))
+			{
+				even_ptr[i] = Vec2f(0.0f,0.0f);
+				odd_ptr[i] = Vec2f(0.0f,0.0f);
+				continue;
+			}
+
+			const float w_x = (i < xswitch) ? float(i)/xsizef : (float(i)-xsizef)/xsizef;
+			const float w = std::sqrt(w_x*w_x + w_y*w_y);
+			const float log_ratio = std::log(w/w0);
+			const float f = std::exp(-log_ratio*log_ratio*scale_const);
+			const float f_re = -f*w_y/w, f_im = f*w_x/w;
+			even_ptr[i] = Vec2f(f*spec_ptr[i][0],f*spec_ptr[i][1]);
+			odd_ptr[i] = Vec2f(spec_ptr[i][0]*f_re - spec_ptr[i][1]*f_im,spec_ptr[i][0]*f_im + spec_ptr[i][1]*f_re);
+		}
+	}
+}
+
+// Scale-space blob detection on signed symmetry. Each scale is filtered from
+// the stored spectrum in turn, and a ring buffer holds the responses and
+// signed symmetry images of the last three scales, so that maxima at the
+// middle scale can be tested against their 26 neighbours in space and scale.
+// The filters are formed on the fly, so nothing is kept between calls
+void monogenicProcessor::detectSymmetryKeypoints(vector<symmetryKeypoint> &keypoints, const vector<float> &wavelengths, const float thresh)
+{
+	const int n_scales = wavelengths.size();
+	const int n_desc_points = 8;
+
+	keypoints.clear();
+	if(n_scales < 3)
+		CV_Error(cv::Error::StsBadArg,"At least three wavelengths are required");
+	for(int s = 1; s < n_scales; ++s)
+	{
+		if(!(wavelengths[s] > wavelengths[s-1]) || !(wavelengths[s-1] > 0.0f))
+			CV_Error(cv::Error::StsBadArg,"The wavelengths must be positive and strictly increasing");
+	}
+	if(im_spectrum.empty())
+		CV_Error(cv::Error::StsError,"The spectrum of the image is not available");
+
+	Mat even_resp[3], odd_resp[3], sym_maps[3][2];
+
+	for(int s = 0; s < n_scales; ++s)
+	{
+		const int slot = s % 3;
+
+		filterSpectrumLogGabor(wavelengths[s],even_resp[slot],odd_resp[slot]);
+		#pragma omp parallel sections
+		{
+			#pragma omp section
+			inverseDFT(even_resp[slot],even_resp[slot],true);
+			#pragma omp section
+			inverseDFT(odd_resp[slot],odd_resp[slot],true);
+		}
+
+		// Positive and negative symmetry at this scale
+		sym_maps[slot][0].create(ysize,xsize,CV_32F);
+		sym_maps[slot][1].create(ysize,xsize,CV_32F);
+		#pragma omp parallel for
+		for(int j = 0; j < ysize; ++j)
+		{
+			const Vec2f* const even_ptr = even_resp[slot].ptr<Vec2f>(j);
+			const Vec2f* const odd_ptr = odd_resp[slot].ptr<Vec2f>(j);
+			float* const pos_ptr = sym_maps[slot][0].ptr<float>(j);
+			float* const neg_ptr = sym_maps[slot][1].ptr<float>(j);
+			for(int i = 0; i < xsize; ++i)
+			{
+				pos_ptr[i] = pixelOutput(OUTPUT_POS_FS,even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+				neg_ptr[i] = pixelOutput(OUTPUT_NEG_FS,even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+			}
+		}
+
+		if(s < 2) continue;
+
+		// Look for maxima at the middle scale of the window
+		const int lower = (s-2) % 3, middle = (s-1) % 3, upper = slot;
+		const float log_step = 0.5f*(std::log(wavelengths[s]) - std::log(wavelengths[s-2]));
+		for(int p = 0; p < 2; ++p)
+		{
+			for(int j = 1; j < ysize - 1; ++j)
+			{
+				const float* const mid_ptr = sym_maps[middle][p].ptr<float>(j);
+				for(int i = 1; i < xsize - 1; ++i)
+				{
+					const float v = mid_ptr[i];
+					if(v <= thresh) continue;
+
+					// Compare against all neighbours in space and scale (ties
+					// with earlier pixels at the same scale are rejected so
+					// that plateaus give a single keypoint)
+					bool is_max = true;
+					for(int dj = -1; (dj <= 1) && is_max; ++dj)
+					{
+						const float* const l_ptr = sym_maps[lower][p].ptr<float>(j+dj);
+						const float* const m_ptr = sym_maps[middle][p].ptr<float>(j+dj);
+						const float* const u_ptr = sym_maps[upper][p].ptr<float>(j+dj);
+						for(int di = -1; di <= 1; ++di)
+						{
+							const bool earlier = (dj < 0) || ((dj == 0) && (di < 0));
+							if((l_ptr[i+di] >= v) || (u_ptr[i+di] >= v)
+								|| ((dj != 0 || di != 0) && ((m_ptr[i+di] > v) || (earlier && (m_ptr[i+di] == v)))))
+							{
+								is_max = false;
+								break;
+							}
+						}
+					}
+					if(!is_max) continue;
+
+					// Refine position and scale by fitting parabolas
+					const float left = mid_ptr[i-1], right = mid_ptr[i+1];
+					const float up = sym_maps[middle][p].at<float>(j-1,i), down = sym_maps[middle][p].at<float>(j+1,i);
+					const float below = sym_maps[lower][p].at<float>(j,i), above = sym_maps[upper][p].at<float>(j,i);
+					const float denom_x = left - 2.0f*v + right;
+					const float denom_y = up - 2.0f*v + down;
+					const float denom_s = below - 2.0f*v + above;
+
+					symmetryKeypoint kp;
+					kp.position.x = float(i) + ((denom_x < 0.0f) ? 0.5f*(left - right)/denom_x : 0.0f);
+					kp.position.y = float(j) + ((denom_y < 0.0f) ? 0.5f*(up - down)/denom_y : 0.0f);
+					kp.wavelength = std::exp(std::log(wavelengths[s-1]) + ((denom_s < 0.0f) ? 0.5f*(below - above)/denom_s : 0.0f)*log_step);
+					kp.polarity = (p == 0) ? 1 : -1;
+					kp.response = v;
+
+					// Sample the normalised monogenic signal around a circle
+					const float radius = 0.5f*wavelengths[s-1];
+					kp.descriptor.resize(2*n_desc_points);
+					for(int d = 0; d < n_desc_points; ++d)
+					{
+						const float angle = 2.0f*float(CV_PI)*float(d)/float(n_desc_points);
+						const float c = std::cos(angle), sn = std::sin(angle);
+						const int x = std::min(std::max(cvRound(i + radius*c),0),xsize-1);
+						const int y = std::min(std::max(cvRound(j + radius*sn),0),ysize-1);
+						const float e = even_resp[middle].at<Vec2f>(y,x)[0];
+						const Vec2f o = odd_resp[middle].at<Vec2f>(y,x);
+						const float a = std::sqrt(e*e + o[0]*o[0] + o[1]*o[1]) + C_EPSILON;
+
+						// The odd part's y component points up the image
+						kp.descriptor[2*d] = e/a;
+						kp.descriptor[2*d+1] = (o[0]*c - o[1]*sn)/a;
+					}
+
+					keypoints.push_back(kp);
+				}
+			}
+		}
+	}
+}
+
+// Histograms of orientation or phase over cells. Threads work on separate
+// rows of cells, so each histogram is accumulated by a single thread and no
+// merging is needed
+void monogenicProcessor::getCellHistograms(Mat &hist, const histogramType type, const int cell_size, const int n_bins)
+{
+	if(even_im_cmplx.empty() || odd_im_cmplx.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+
+	if((cell_size < 1) || (n_bins < 1))
+		CV_Error(cv::Error::StsBadArg,"Cell size and number of bins must be positive");
+
+	const int n_cells_y = ysize / cell_size;
+	const int n_cells_x = xsize / cell_size;
+	const bool circular = (type == HISTOGRAM_ORIENTATION);
+	const float range = circular ? 2.0f*float(CV_PI) : float(CV_PI);
+	const float bin_scale = float(n_bins) / range;
+
+	hist = Mat::zeros(n_cells_y*n_cells_x,n_bins,CV_32F);
+
+	#pragma omp parallel for
+	for(int cy = 0; cy < n_cells_y; ++cy)
+	{
+		for(int j = cy*cell_size; j < (cy+1)*cell_size; ++j)
+		{
+			const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+			const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+			for(int i = 0; i < n_cells_x*cell_size; ++i)
+			{
+				const float e = even_ptr[i][0], o_x = odd_ptr[i][0], o_y = odd_ptr[i][1];
+				const float a = pixelOutput(OUTPUT_AMPLITUDE,e,o_x,o_y,T);
+				const float value = circular ? pixelOutput(OUTPUT_ORIENTATION,e,o_x,o_y,T) : pixelOutput(OUTPUT_LOCAL_PHASE,e,o_x,o_y,T);
+
+				// Position relative to the bin centres
+				const float pos = value*bin_scale - 0.5f;
+				int bin0 = cvFloor(pos);
+				const float frac = pos - float(bin0);
+				int bin1 = bin0 + 1;
+				if(circular)
+				{
+					bin0 = (bin0 + n_bins) % n_bins;
+					bin1 = bin1 % n_bins;
+				}
+				else
+				{
+					bin0 = std::max(bin0,0);
+					bin1 = std::min(bin1,n_bins-1);
+				}
+
+				float* const hist_ptr = hist.ptr<float>(cy*n_cells_x + i/cell_size);
+				hist_ptr[bin0] += (1.0f - frac)*a;
+				hist_ptr[bin1] += frac*a;
+			}
+		}
+	}
+}
+
+// Summary statistics in a single pass. Threads work on bands of rows one block
+// high, so block sums have a single writer, while the global statistics are
+// accumulated per thread and merged at the end
+void monogenicProcessor::getStatistics(const statisticsConfig &config, vector<outputStatistics> &stats)
+{
+	if(even_im_cmplx.empty() || odd_im_cmplx.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+
+	const int n_outputs = config.outputs.size();
+	const int band = (config.block_size > 0) ? config.block_size : 16;
+	const int n_bands = (ysize + band - 1) / band;
+	const int n_blocks_x = (config.block_size > 0) ? (xsize + band - 1) / band : 0;
+	const int n_bins = config.n_hist_bins;
+	if((n_bins > 0) && !(config.hist_max > config.hist_min))
+		CV_Error(cv::Error::StsBadArg,"The maximum of the histogram range must be greater than the minimum");
+	const float bin_scale = (n_bins > 0) ? float(n_bins) / (config.hist_max - config.hist_min) : 0.0f;
+
+	stats.resize(n_outputs);
+	for(int k = 0; k < n_outputs; ++k)
+	{
+		stats[k].output = config.outputs[k];
+		stats[k].sum = 0.0;
+		stats[k].min = std::numeric_limits<float>::max();
+		stats[k].max = -std::numeric_limits<float>::max();
+		stats[k].nonzero_fraction = 0.0;
+		stats[k].histogram.assign(n_bins,0);
+		stats[k].hist_min = config.hist_min;
+		stats[k].hist_max = config.hist_max;
+		if(config.block_size > 0)
+			stats[k].block_means = Mat::zeros(n_bands,n_blocks_x,CV_32F);
+		else
+			stats[k].block_means.release();
+	}
+
+	#pragma omp parallel
+	{
+		// Per-thread accumulators
+		vector<double> sums(n_outputs,0.0);
+		vector<float> mins(n_outputs,std::numeric_limits<float>::max()), maxs(n_outputs,-std::numeric_limits<float>::max());
+		vector<long> nonzeros(n_outputs,0);
+		vector<int> hists(n_outputs*n_bins,0);
+
+		#pragma omp for
+		for(int b = 0; b < n_bands; ++b)
+		{
+			const int j_end = std::min((b+1)*band,ysize);
+			for(int j = b*band; j < j_end; ++j)
+			{
+				const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+				const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+				for(int i = 0; i < xsize; ++i)
+				{
+					for(int k = 0; k < n_outputs; ++k)
+					{
+						const float v = pixelOutput(config.outputs[k],even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+						sums[k] += v;
+						mins[k] = std::min(mins[k],v);
+						maxs[k] = std::max(maxs[k],v);
+						if(v != 0.0f) ++nonzeros[k];
+						if(n_bins > 0)
+						{
+							const int bin = std::min(std::max(cvFloor((v - config.hist_min)*bin_scale),0),n_bins-1);
+							++hists[k*n_bins + bin];
+						}
+						if(config.block_size > 0)
+							stats[k].block_means.at<float>(b,i/band) += v;
+					}
+				}
+			}
+
+			// Convert this band's block sums to means
+			if(config.block_size > 0)
+			{
+				const int height = j_end - b*band;
+				for(int k = 0; k < n_outputs; ++k)
+				{
+					float* const block_ptr = stats[k].block_means.ptr<float>(b);
+					for(int bx = 0; bx < n_blocks_x; ++bx)
+						block_ptr[bx] /= float(height*(std::min((bx+1)*band,xsize) - bx*band));
+				}
+			}
+		}
+
+		#pragma omp critical
+		{
+			for(int k = 0; k < n_outputs; ++k)
+			{
+				stats[k].sum += sums[k];
+				stats[k].min = std::min(stats[k].min,mins[k]);
+				stats[k].max = std::max(stats[k].max,maxs[k]);
+				stats[k].nonzero_fraction += double(nonzeros[k]);
+				for(int h = 0; h < n_bins; ++h)
+					stats[k].histogram[h] += hists[k*n_bins + h];
+			}
+		}
+	}
+
+	const double n_pixels = double(ysize)*double(xsize);
+	for(int k = 0; k < n_outputs; ++k)
+	{
+		stats[k].mean = stats[k].sum / n_pixels;
+		stats[k].nonzero_fraction /= n_pixels;
+	}
+}
+
+// Percentile from the histogram, interpolating linearly within the bin
+float outputStatistics::percentile(const float p) const
+{
+	const int n_bins = histogram.size();
+	if(n_bins == 0)
+		CV_Error(cv::Error::StsError,"No histogram was accumulated");
+
+	long total = 0;
+	for(int h = 0; h < n_bins; ++h)
+		total += histogram[h];
+
+	const double target = double(p)*double(total);
+	const float bin_width = (hist_max - hist_min) / float(n_bins);
+	long cumulative = 0;
+	for(int h = 0; h < n_bins; ++h)
+	{
+		if((histogram[h] > 0) && (double(cumulative + histogram[h]) >= target))
+			return hist_min + bin_width*(float(h) + float((target - double(cumulative)) / double(histogram[h])));
+		cumulative += histogram[h];
+	}
+	return hist_max;
+}
+
+// Summed-area tables. Each row of every output is calculated and its running
+// sum written in a row-parallel pass, then the row sums are accumulated down
+// the columns, with threads working on separate sets of columns
+void monogenicProcessor::getIntegralImages(const vector<outputType> &outputs, vector<Mat> &sats)
+{
+	if(even_im_cmplx.empty() || odd_im_cmplx.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+
+	const int n_outputs = outputs.size();
+
+	sats.resize(n_outputs);
+	for(int k = 0; k < n_outputs; ++k)
+	{
+		sats[k].create(ysize+1,xsize+1,CV_64F);
+		sats[k].row(0).setTo(Scalar::all(0));
+	}
+
+	#pragma omp parallel for
+	for(int j = 0; j < ysize; ++j)
+	{
+		const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+		const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+		for(int k = 0; k < n_outputs; ++k)
+		{
+			double* const sat_ptr = sats[k].ptr<double>(j+1);
+			double row_sum = 0.0;
+			sat_ptr[0] = 0.0;
+			for(int i = 0; i < xsize; ++i)
+			{
+				row_sum += pixelOutput(outputs[k],even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+				sat_ptr[i+1] = row_sum;
+			}
+		}
+	}
+
+	const int col_chunk = 256;
+	const int n_chunks = (xsize + 1 + col_chunk - 1) / col_chunk;
+	#pragma omp parallel for collapse(2)
+	for(int k = 0; k < n_outputs; ++k)
+	{
+		for(int c = 0; c < n_chunks; ++c)
+		{
+			const int i_start = c*col_chunk, i_end = std::min((c+1)*col_chunk,xsize+1);
+			for(int j = 2; j <= ysize; ++j)
+			{
+				const double* const above_ptr = sats[k].ptr<double>(j-1);
+				double* const sat_ptr = sats[k].ptr<double>(j);
+				for(int i = i_start; i < i_end; ++i)
+					sat_ptr[i] += above_ptr[i];
+			}
+		}
+	}
+}
+
+// Set up the temporal filter state
+void monogenicProcessor::setTemporalFilter(const vector<outputType> &outputs, const float alpha)
+{
+	temporal_outputs = outputs;
+	temporal_alpha = alpha;
+	temporal_states.assign(outputs.size(),Mat());
+	temporal_initialised = false;
+}
+
+// Remove the temporal filter state
+void monogenicProcessor::clearTemporalFilter()
+{
+	temporal_outputs.clear();
+	temporal_states.clear();
+	temporal_ori.release();
+	temporal_initialised = false;
+}
+
+// Update the moving averages from the new filter responses in one pass
+void monogenicProcessor::updateTemporalState()
+{
+	stageProfiler::scope timing(profiler,STAGE_TEMPORAL);
+	const int n_outputs = temporal_outputs.size();
+	// On the first image the states are written directly, as their newly
+	// allocated contents must not be read
+	const bool first = !temporal_initialised;
+	const float alpha = temporal_alpha;
+
+	if(first)
+	{
+		for(int k = 0; k < n_outputs; ++k)
+			temporal_states[k].create(pad_ysize,pad_xsize,(temporal_outputs[k] == OUTPUT_ORIENTATION) ? CV_32FC2 : CV_32F);
+	}
+
+	#pragma omp parallel for
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+		const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+		for(int k = 0; k < n_outputs; ++k)
+		{
+			if(temporal_outputs[k] == OUTPUT_ORIENTATION)
+			{
+				// Doubling the angle of the odd vector maps opposite
+				// directions to the same vector, and the magnitude weights
+				// the average towards reliable orientations
+				Vec2f* const state_ptr = temporal_states[k].ptr<Vec2f>(j);
+				for(int i = 0; i < pad_xsize; ++i)
+				{
+					const float o_x = odd_ptr[i][0], o_y = odd_ptr[i][1];
+					const float o_mag = std::sqrt(o_x*o_x + o_y*o_y) + C_EPSILON;
+					const float d_x = (o_x*o_x - o_y*o_y)/o_mag, d_y = 2.0f*o_x*o_y/o_mag;
+					state_ptr[i][0] = first ? d_x : state_ptr[i][0] + alpha*(d_x - state_ptr[i][0]);
+					state_ptr[i][1] = first ? d_y : state_ptr[i][1] + alpha*(d_y - state_ptr[i][1]);
+				}
+			}
+			else
+			{
+				float* const state_ptr = temporal_states[k].ptr<float>(j);
+				for(int i = 0; i < pad_xsize; ++i)
+				{
+					const float x = pixelOutput(temporal_outputs[k],even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+					state_ptr[i] = first ? x : state_ptr[i] + alpha*(x - state_ptr[i]);
+				}
+			}
+		}
+	}
+
+	temporal_initialised = true;
+}
+
+// Returns a smoothed output, converting the doubled-angle vector back to an
+// orientation if necessary
+void monogenicProcessor::getTemporalOutput(const outputType output, Mat &result)
+{
+	for(size_t k = 0; k < temporal_outputs.size(); ++k)
+	{
+		if(temporal_outputs[k] != output) continue;
+
+		if(!temporal_initialised)
+			CV_Error(cv::Error::StsError,"No images have been processed since the temporal filter was set");
+
+		if(output == OUTPUT_ORIENTATION)
+		{
+			temporal_ori.create(pad_ysize,pad_xsize,CV_32F);
+			for(int j = 0; j < pad_ysize; ++j)
+			{
+				const Vec2f* const state_ptr = temporal_states[k].ptr<Vec2f>(j);
+				float* const ori_ptr = temporal_ori.ptr<float>(j);
+				for(int i = 0; i < pad_xsize; ++i)
+				{
+					const float angle = 0.5f*std::atan2(state_ptr[i][1],state_ptr[i][0]);
+					ori_ptr[i] = (angle < 0.0f) ? angle + float(CV_PI) : angle;
+				}
+			}
+			result = temporal_ori;
+		}
+		else
+			result = temporal_states[k];
+		return;
+	}
+	CV_Error(cv::Error::StsBadArg,"Output is not temporally filtered");
+}
+
+// Outputs of transformed images. Scalar outputs are unchanged by rotating or
+// reflecting the image, other than by the rearrangement of their pixels. The
+// odd part is a vector, which is rotated or reflected along with the grid
+void monogenicProcessor::getDihedralOutput(const dihedralTransform transform, const outputType output, Mat &result)
+{
+	const Rect roi(0,0,xsize,ysize);
+
+	if((output != OUTPUT_ODD_X) && (output != OUTPUT_ODD_Y) && (output != OUTPUT_ORIENTATION))
+	{
+		transformGrid(findOutput(output)(roi),result,transform);
+		return;
+	}
+
+	// Coefficients giving the new odd components from the old, as
+	// [o_x' o_y'] = [a b ; c d] [o_x o_y] (the odd y component points up the
+	// image, opposite to the row index)
+	static const float coeffs[8][4] = {
+		{ 1.0f, 0.0f, 0.0f, 1.0f},   // identity
+		{ 0.0f, 1.0f,-1.0f, 0.0f},   // rotate 90 clockwise
+		{-1.0f, 0.0f, 0.0f,-1.0f},   // rotate 180
+		{ 0.0f,-1.0f, 1.0f, 0.0f},   // rotate 90 anticlockwise
+		{-1.0f, 0.0f, 0.0f, 1.0f},   // flip x
+		{ 1.0f, 0.0f, 0.0f,-1.0f},   // flip y
+		{ 0.0f,-1.0f,-1.0f, 0.0f},   // transpose
+		{ 0.0f, 1.0f, 1.0f, 0.0f}    // anti-transpose
+	};
+	const float* const c = coeffs[transform];
+
+	if(!odd_valid) splitOdd();
+	Mat odd_x, odd_y;
+	transformGrid(odd_ims[0](roi),odd_x,transform);
+	transformGrid(odd_ims[1](roi),odd_y,transform);
+
+	result.create(odd_x.size(),CV_32F);
+	for(int j = 0; j < result.rows; ++j)
+	{
+		const float* const x_ptr = odd_x.ptr<float>(j);
+		const float* const y_ptr = odd_y.ptr<float>(j);
+		float* const res_ptr = result.ptr<float>(j);
+		for(int i = 0; i < result.cols; ++i)
+		{
+			const float new_x = c[0]*x_ptr[i] + c[1]*y_ptr[i];
+			const float new_y = c[2]*x_ptr[i] + c[3]*y_ptr[i];
+			res_ptr[i] = pixelOutput(output,0.0f,new_x,new_y,T);
+		}
+	}
+}
+
+// All eight transformed versions of an output
+void monogenicProcessor::getDihedralOutputs(const outputType output, vector<Mat> &results)
+{
+	results.resize(8);
+	for(int t = 0; t < 8; ++t)
+		getDihedralOutput(dihedralTransform(t),output,results[t]);
+}
+
+// Batch of crops, calculated from the filter responses straight into the
+// batch matrix
+void monogenicProcessor::getCropBatch(const vector<Point> &origins, const Size &crop_size, const vector<outputType> &outputs, Mat &batch)
+{
+	if(even_im_cmplx.empty() || odd_im_cmplx.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+
+	const int n_crops = origins.size();
+	const int n_outputs = outputs.size();
+
+	for(int n = 0; n < n_crops; ++n)
+	{
+		if((origins[n].x < 0) || (origins[n].y < 0) || (origins[n].x + crop_size.width > xsize) || (origins[n].y + crop_size.height > ysize))
+			CV_Error(cv::Error::StsOutOfRange,"Crop windows must lie within the image");
+	}
+
+	const int dims[4] = {n_crops,n_outputs,crop_size.height,crop_size.width};
+	batch.create(4,dims,CV_32F);
+	float* const batch_ptr = batch.ptr<float>();
+
+	#pragma omp parallel for collapse(2)
+	for(int n = 0; n < n_crops; ++n)
+	{
+		for(int r = 0; r < crop_size.height; ++r)
+		{
+			const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(origins[n].y + r) + origins[n].x;
+			const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(origins[n].y + r) + origins[n].x;
+			for(int k = 0; k < n_outputs; ++k)
+			{
+				float* const out_ptr = batch_ptr + ((size_t(n)*n_outputs + k)*crop_size.height + r)*crop_size.width;
+				for(int i = 0; i < crop_size.width; ++i)
+					out_ptr[i] = pixelOutput(outputs[k],even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+			}
+		}
+	}
+}
+
+// All requested outputs in one pass over the filter responses, written
+// either together for each pixel or as separate planes
+void monogenicProcessor::getInterleaved(const vector<outputType> &outputs, Mat &result, const tensorLayout layout)
+{
+	if(even_im_cmplx.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+	const int n_outputs = outputs.size();
+	if(n_outputs == 0)
+		CV_Error(cv::Error::StsBadArg,"At least one output must be requested");
+
+	if(layout == LAYOUT_HWC)
+	{
+		if(n_outputs > CV_CN_MAX)
+			CV_Error(cv::Error::StsBadArg,"Too many outputs for an interleaved image");
+		result.create(ysize,xsize,CV_32FC(n_outputs));
+	}
+	else
+	{
+		const int dims[3] = {n_outputs,ysize,xsize};
+		result.create(3,dims,CV_32F);
+	}
+
+	stageProfiler::scope timing(profiler,STAGE_FUSED_OUTPUTS);
+	const size_t plane_size = size_t(ysize)*xsize;
+
+	#pragma omp parallel for
+	for(int j = 0; j < ysize; ++j)
+	{
+		const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+		const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+		if(layout == LAYOUT_HWC)
+		{
+			float* const out_ptr = result.ptr<float>(j);
+			for(int i = 0; i < xsize; ++i)
+				for(int k = 0; k < n_outputs; ++k)
+					out_ptr[i*n_outputs + k] = pixelOutput(outputs[k],even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+		}
+		else
+		{
+			for(int k = 0; k < n_outputs; ++k)
+			{
+				float* const out_ptr = result.ptr<float>() + k*plane_size + size_t(j)*xsize;
+				for(int i = 0; i < xsize; ++i)
+					out_ptr[i] = pixelOutput(outputs[k],even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T);
+			}
+		}
+	}
+}
+
+// The forward transform takes the input x to the responses
+// z = IDFT(H.DFT(x)) for each filter H, with the even part the real part of
+// its response and the odd components the real and imaginary parts of the
+// other. The adjoint of each is IDFT(conj(H).DFT(g)) applied to the complex
+// gradient g of its response, and the input gradient is the real part of the
+// sum. By Parseval's theorem, the derivative of the loss with respect to a
+// filter parameter p is Re(sum(dH/dp . S . conj(DFT(g))))/N over the
+// frequencies, where S is the spectrum of the image and N the number of
+// pixels. The Riesz part of the odd filter does not depend on the
+// parameters, so both filters contribute through the log Gabor gain f, with
+// df/dwavelength = -2.f.c.log(w.wavelength)/wavelength and
+// df/dsigma = f.log(w.wavelength)^2/(sigma.log(sigma)^3), where
+// c = 1/(2.log(sigma)^2)
+void monogenicProcessor::backward(const vector<outputType> &outputs, const vector<Mat> &output_grads, Mat &input_grad, float *wavelength_grad, float *shape_sigma_grad)
+{
+	if(even_im_cmplx.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+	if(result_recursive)
+		CV_Error(cv::Error::StsNotImplemented,"The backward pass is not available for the recursive approximation");
+	if(outputs.size() != output_grads.size())
+		CV_Error(cv::Error::StsBadArg,"There must be one gradient for each output");
+	for(size_t k = 0; k < output_grads.size(); ++k)
+	{
+		const Size grad_size = output_grads[k].size();
+		if((output_grads[k].type() != CV_32F) || ((grad_size != Size(xsize,ysize)) && (grad_size != Size(pad_xsize,pad_ysize))))
+			CV_Error(cv::Error::StsBadArg,"Gradients must be CV_32F with the image size or the transform size");
+	}
+	const bool param_grads = (wavelength_grad != nullptr) || (shape_sigma_grad != nullptr);
+	if(param_grads && radial_profile)
+		CV_Error(cv::Error::StsNotImplemented,"Parameter gradients are only available for the log Gabor profile");
+	if(param_grads && im_spectrum.empty())
+		CV_Error(cv::Error::StsError,"Parameter gradients need the spectrum of the image, which is not kept with MEMORY_DROP_SPECTRUM");
+
+	stageProfiler::scope timing(profiler,STAGE_BACKWARD);
+	const int n_outputs = outputs.size();
+
+	// Chain rule at each pixel, giving the gradients with respect to the even
+	// response (real) and the odd response (complex)
+	grad_even.create(pad_ysize,pad_xsize,CV_32FC2);
+	grad_odd.create(pad_ysize,pad_xsize,CV_32FC2);
+	#pragma omp parallel for
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2f* const even_ptr = even_im_cmplx.ptr<Vec2f>(j);
+		const Vec2f* const odd_ptr = odd_im_cmplx.ptr<Vec2f>(j);
+		Vec2f* const ge_ptr = grad_even.ptr<Vec2f>(j);
+		Vec2f* const go_ptr = grad_odd.ptr<Vec2f>(j);
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			float g_e = 0.0f, g_x = 0.0f, g_y = 0.0f;
+			for(int k = 0; k < n_outputs; ++k)
+			{
+				if((j >= output_grads[k].rows) || (i >= output_grads[k].cols))
+					continue;
+				const float g = output_grads[k].ptr<float>(j)[i];
+				if(g == 0.0f)
+					continue;
+				float d_e, d_x, d_y;
+				pixelOutputGradient(outputs[k],even_ptr[i][0],odd_ptr[i][0],odd_ptr[i][1],T,d_e,d_x,d_y);
+				g_e += g*d_e;
+				g_x += g*d_x;
+				g_y += g*d_y;
+			}
+			ge_ptr[i] = Vec2f(g_e,0.0f);
+			go_ptr[i] = Vec2f(g_x,g_y);
+		}
+	}
+
+	if(latency_mode)
+	{
+		forwardDFT(grad_even,grad_even);
+		forwardDFT(grad_odd,grad_odd);
+	}
+	else
+	{
+		#pragma omp parallel sections
+		{
+			#pragma omp section
+			forwardDFT(grad_even,grad_even);
+			#pragma omp section
+			forwardDFT(grad_odd,grad_odd);
+		}
+	}
+
+	// Multiply by the conjugate filters and sum, in place in the even buffer.
+	// The odd filter is the even gain times the Riesz factor (-w_y + i.w_x)/w
+	// (as in createLogGaborRieszFilt), so this is formed from the gain whether
+	// the filters are held in full or at half precision
+	const float xsizef = float(pad_xsize);
+	const float ysizef = float(pad_ysize);
+	const int xswitch = (pad_xsize % 2 == 0) ? pad_xsize/2 : (pad_xsize+1)/2;
+	const int yswitch = (pad_ysize % 2 == 0) ? pad_ysize/2 : (pad_ysize+1)/2;
+	const double log_sigma = std::log(double(sigma_onf));
+	const double scale_const = 1.0/(2.0*log_sigma*log_sigma);
+	double sum_wl = 0.0, sum_sigma = 0.0;
+
+	#pragma omp parallel reduction(+:sum_wl,sum_sigma)
+	{
+		vector<float> gains(pad_xsize);
+
+		#pragma omp for
+		for(int j = 0; j < pad_ysize; ++j)
+		{
+			evenFilterRow(j,gains.data());
+			const float w_y = (j < yswitch) ? float(-j)/ysizef : (ysizef - float(j))/ysizef;
+			Vec2f* const ge_ptr = grad_even.ptr<Vec2f>(j);
+			const Vec2f* const go_ptr = grad_odd.ptr<Vec2f>(j);
+			const Vec2f* const spec_ptr = param_grads ? im_spectrum.ptr<Vec2f>(j) : nullptr;
+			for(int i = 0; i < pad_xsize; ++i)
+			{
+				const float w_x = (i < xswitch) ? float(i)/xsizef : (float(i)-xsizef)/xsizef;
+				const float w = std::sqrt(w_x*w_x + w_y*w_y);
+				const float c_re = (w > 0.0f) ? -w_y/w : 0.0f;
+				const float c_im = (w > 0.0f) ? -w_x/w : 0.0f;
+
+				// t = DFT(g_e) + conj(R).DFT(g_o)
+				const float t_re = ge_ptr[i][0] + c_re*go_ptr[i][0] - c_im*go_ptr[i][1];
+				const float t_im = ge_ptr[i][1] + c_re*go_ptr[i][1] + c_im*go_ptr[i][0];
+				ge_ptr[i] = Vec2f(gains[i]*t_re,gains[i]*t_im);
+
+				// The parameter gradients take Re(dH/dp . S . conj(DFT(g)))
+				// summed over both filters, which is df/dp . Re(S . conj(t))
+				if(param_grads && (gains[i] > 0.0f))
+				{
+					const double log_w = std::log(double(w)*wl);
+					const double s_dot_t = double(spec_ptr[i][0])*t_re + double(spec_ptr[i][1])*t_im;
+					sum_wl += -2.0*gains[i]*scale_const*log_w/wl*s_dot_t;
+					sum_sigma += gains[i]*log_w*log_w/(sigma_onf*log_sigma*log_sigma*log_sigma)*s_dot_t;
+				}
+			}
+		}
+	}
+
+	inverseDFT(grad_even,grad_even,true);
+
+	input_grad.create(ysize,xsize,CV_32F);
+	for(int j = 0; j < ysize; ++j)
+	{
+		const Vec2f* const ge_ptr = grad_even.ptr<Vec2f>(j);
+		float* const out_ptr = input_grad.ptr<float>(j);
+		for(int i = 0; i < xsize; ++i)
+			out_ptr[i] = ge_ptr[i][0];
+	}
+
+	const double n_pixels = double(pad_ysize)*double(pad_xsize);
+	if(wavelength_grad != nullptr)
+		*wavelength_grad = float(sum_wl/n_pixels);
+	if(shape_sigma_grad != nullptr)
+		*shape_sigma_grad = float(sum_sigma/n_pixels);
+}
+
+// Use the spectrum of the most recent image as the registration reference
+void monogenicProcessor::setRegistrationReference()
+{
+	if(im_spectrum.empty())
+		CV_Error(cv::Error::StsError,"The spectrum of the image is not available");
+	im_spectrum.copyTo(reg_ref_spectrum);
+	reg_ref_valid = true;
+	reg_ref_log_polar_valid = false;
+}
+
+// Use the spectrum of a new image as the registration reference
+void monogenicProcessor::setRegistrationReference(const Mat &I)
+{
+	findSpectrum(I,reg_ref_spectrum);
+	reg_ref_valid = true;
+	reg_ref_log_polar_valid = false;
+}
+
+// Phase correlation between the monogenic signals of the current image and
+// the reference. The cross-power spectrum of the vector-valued monogenic
+// signals is F.conj(R).(|H_even|^2 + |H_odd|^2), which for the log Gabor/Riesz
+// filter pair is 2.F.conj(R).|H_even|^2. This is normalised to unit magnitude
+// as in standard phase correlation, and then weighted by the squared filter,
+// meaning the result depends only on local phase within the band of the filter
+// and is robust to changes in illumination and contrast
+Point2d monogenicProcessor::registerToReference(const bool subpixel, double *response)
+{
+	if(!reg_ref_valid || im_spectrum.empty())
+		CV_Error(cv::Error::StsError,"No registration reference has been set");
+
+	// Form the weighted, normalised cross-power spectrum
+	reg_corr.create(pad_ysize,pad_xsize,CV_32FC2);
+	double weight_sum = 0.0;
+	vector<float> gains(pad_xsize);
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2f* const f_ptr = im_spectrum.ptr<Vec2f>(j);
+		const Vec2f* const r_ptr = reg_ref_spectrum.ptr<Vec2f>(j);
+		Vec2f* const corr_ptr = reg_corr.ptr<Vec2f>(j);
+		evenFilterRow(j,gains.data());
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			const float re = f_ptr[i][0]*r_ptr[i][0] + f_ptr[i][1]*r_ptr[i][1];
+			const float im = f_ptr[i][1]*r_ptr[i][0] - f_ptr[i][0]*r_ptr[i][1];
+			const float w = gains[i]*gains[i];
+			const float scale = w / (std::sqrt(re*re + im*im) + C_EPSILON);
+			corr_ptr[i][0] = re*scale;
+			corr_ptr[i][1] = im*scale;
+			weight_sum += w;
+		}
+	}
+
+	// The single extra inverse DFT gives the correlation surface. No scaling
+	// is applied, so a perfect match gives a peak of weight_sum
+	inverseDFT(reg_corr,reg_corr,false);
+
+	// Locate the peak of the real part
+	int peak_x = 0, peak_y = 0;
+	float peak_val = -std::numeric_limits<float>::max();
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2f* const corr_ptr = reg_corr.ptr<Vec2f>(j);
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			if(corr_ptr[i][0] > peak_val)
+			{
+				peak_val = corr_ptr[i][0];
+				peak_x = i;
+				peak_y = j;
+			}
+		}
+	}
+
+	Point2d shift(peak_x,peak_y);
+
+	// Fit a parabola through the peak and its neighbours along each axis
+	// (wrapping around the edges as the correlation is circular)
+	if(subpixel)
+	{
+		const float left = reg_corr.at<Vec2f>(peak_y,(peak_x + pad_xsize - 1) % pad_xsize)[0];
+		const float right = reg_corr.at<Vec2f>(peak_y,(peak_x + 1) % pad_xsize)[0];
+		const float up = reg_corr.at<Vec2f>((peak_y + pad_ysize - 1) % pad_ysize,peak_x)[0];
+		const float down = reg_corr.at<Vec2f>((peak_y + 1) % pad_ysize,peak_x)[0];
+		const float denom_x = left - 2.0f*peak_val + right;
+		const float denom_y = up - 2.0f*peak_val + down;
+		if(denom_x < 0.0f)
+			shift.x += 0.5*(left - right)/denom_x;
+		if(denom_y < 0.0f)
+			shift.y += 0.5*(up - down)/denom_y;
+	}
+
+	// Shifts beyond half the image size are negative shifts
+	if(shift.x > 0.5*pad_xsize) shift.x -= pad_xsize;
+	if(shift.y > 0.5*pad_ysize) shift.y -= pad_ysize;
+
+	if(response != nullptr)
+		*response = (weight_sum > 0.0) ? peak_val/weight_sum : 0.0;
+
+	return shift;
+}
+
+// Translation as above, plus rotation and scale from the log-polar transform
+// of the magnitude spectra (which are invariant to translation)
+Point2d monogenicProcessor::registerToReference(double &rotation, double &scale, const bool subpixel, double *response)
+{
+	const Point2d shift = registerToReference(subpixel,response);
+
+	if(!reg_ref_log_polar_valid)
+	{
+		findLogPolarSpectrum(reg_ref_spectrum,reg_ref_log_polar);
+		reg_ref_log_polar_valid = true;
+	}
+
+	Mat log_polar;
+	findLogPolarSpectrum(im_spectrum,log_polar);
+
+	// Rows of the log-polar image are angle and columns are log radius
+	const Point2d lp_shift = phaseCorrelate(reg_ref_log_polar,log_polar);
+	const double max_radius = 0.5*std::min(pad_xsize,pad_ysize);
+	const double log_scale_const = log_polar.cols / std::log(max_radius);
+
+	// Magnitude spectra are symmetric, so the angle is only defined over 180
+	// degrees
+	rotation = lp_shift.y * 360.0 / log_polar.rows;
+	while(rotation >= 90.0) rotation -= 180.0;
+	while(rotation < -90.0) rotation += 180.0;
+
+	// Magnifying the image shrinks its spectrum
+	scale = std::exp(-lp_shift.x / log_scale_const);
+
+	return shift;
+}
+
+// Finds the centred, high-pass emphasised log magnitude spectrum and
+// resamples it onto a log-polar grid
+void monogenicProcessor::findLogPolarSpectrum(const Mat &spectrum, Mat &log_polar)
+{
+	Mat mag(pad_ysize,pad_xsize,CV_32F);
+
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2f* const spec_ptr = spectrum.ptr<Vec2f>(j);
+		float* const mag_ptr = mag.ptr<float>((j + pad_ysize/2) % pad_ysize);
+		const float cos_y = std::cos(float(CV_PI)*float(std::min(j,pad_ysize-j))/float(pad_ysize));
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			// High-pass filter to suppress the dominant low frequencies
+			const float x = std::cos(float(CV_PI)*float(std::min(i,pad_xsize-i))/float(pad_xsize)) * cos_y;
+			const float hp = (1.0f - x)*(2.0f - x);
+			mag_ptr[(i + pad_xsize/2) % pad_xsize] = hp*std::log(1.0f + std::sqrt(spec_ptr[i][0]*spec_ptr[i][0] + spec_ptr[i][1]*spec_ptr[i][1]));
+		}
+	}
+
+	const double max_radius = 0.5*std::min(pad_xsize,pad_ysize);
+	const int n_radius = std::min(pad_xsize,pad_ysize)/2;
+	const int n_angle = n_radius;
+	warpPolar(mag,log_polar,Size(n_radius,n_angle),Point2f(0.5f*pad_xsize,0.5f*pad_ysize),max_radius,INTER_LINEAR + WARP_FILL_OUTLIERS + WARP_POLAR_LOG);
+}
+
+// Box sums from the four corners of each box in the summed-area table
+void sumBoxes(const Mat &sat, const vector<Rect> &boxes, vector<double> &sums)
+{
+	CV_Assert((sat.type() == CV_64F) && sat.isContinuous());
+
+	const int n_boxes = boxes.size();
+	const int stride = sat.cols;
+	const double* const sat_ptr = sat.ptr<double>();
+	const Rect* const box_ptr = boxes.data();
+
+	// The table has one more row and column than the image. The boxes are
+	// checked before the vectorised loop, which reads the corners unchecked
+	for(int b = 0; b < n_boxes; ++b)
+	{
+		const Rect &box = box_ptr[b];
+		if((box.x < 0) || (box.y < 0) || (box.width < 0) || (box.height < 0)
+			|| (box.x + box.width >= sat.cols) || (box.y + box.height >= sat.rows))
+			CV_Error(cv::Error::StsOutOfRange,"The boxes must lie within the image");
+	}
+
+	sums.resize(n_boxes);
+	double* const sums_ptr = sums.data();
+
+	#pragma omp parallel for simd
+	for(int b = 0; b < n_boxes; ++b)
+	{
+		const int top = box_ptr[b].y*stride;
+		const int bottom = (box_ptr[b].y + box_ptr[b].height)*stride;
+		const int left = box_ptr[b].x;
+		const int right = box_ptr[b].x + box_ptr[b].width;
+		sums_ptr[b] = sat_ptr[bottom + right] - sat_ptr[top + right] - sat_ptr[bottom + left] + sat_ptr[top + left];
+	}
 }
 
 } // end of namespace
@@ -1,10 +1,151 @@
 #ifndef MONOGENICFEATEXTRACTOR_H
 #define MONOGENICFEATEXTRACTOR_H
 #include <opencv2/core/core.hpp>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "radialProfiles.h"
+#include "exactDFT.h"
+#include "stageProfiler.h"
+#include "processorMetrics.h"
 
 namespace monogenic
 {
 
+// How the image is padded before taking the DFT
+enum paddingMode
+{
+	PADDING_OPTIMAL,        // pad each dimension up to the next size that cv::dft handles efficiently
+	PADDING_NONE,           // use the exact image size, with Bluestein's algorithm for awkward sizes
+	PADDING_AUTO            // choose padding or not for each dimension with a cost model
+};
+
+// Strategies for reducing the memory held by a processor, which may be
+// combined as bit flags
+enum memoryStrategy
+{
+	MEMORY_DEFAULT = 0,
+	MEMORY_FUSED_OUTPUTS = 1,   // find outputs directly from the responses, without intermediate images
+	MEMORY_HALF_FILTERS = 2,    // store the filter as a half precision radial gain, forming the Riesz part as needed
+	MEMORY_DROP_SPECTRUM = 4    // do not keep the spectrum of the image (prevents registration, keypoints and denoising)
+};
+
+// Memory held by one of the processor's buffers
+struct bufferUsage
+{
+	std::string name;
+	size_t bytes;
+};
+
+// Identifies one of the output images that may be calculated from the
+// monogenic representation
+enum outputType
+{
+	OUTPUT_EVEN,            // even part
+	OUTPUT_ODD_X,           // x component of the odd part
+	OUTPUT_ODD_Y,           // y component of the odd part
+	OUTPUT_ODD_MAG,         // magnitude of the odd part
+	OUTPUT_ORIENTATION,     // local orientation
+	OUTPUT_AMPLITUDE,       // local amplitude (energy)
+	OUTPUT_FS,              // feature symmetry
+	OUTPUT_FA,              // feature asymmetry
+	OUTPUT_POS_FS,          // positive part of signed feature symmetry
+	OUTPUT_NEG_FS,          // negative part of signed feature symmetry
+	OUTPUT_LOCAL_PHASE      // local phase
+};
+
+// The eight rotations and reflections of the image grid (the dihedral group)
+enum dihedralTransform
+{
+	DIHEDRAL_IDENTITY,
+	DIHEDRAL_ROTATE_90,       // rotate 90 degrees clockwise
+	DIHEDRAL_ROTATE_180,
+	DIHEDRAL_ROTATE_270,      // rotate 90 degrees anticlockwise
+	DIHEDRAL_FLIP_X,          // mirror left to right
+	DIHEDRAL_FLIP_Y,          // mirror top to bottom
+	DIHEDRAL_TRANSPOSE,       // reflect in the main diagonal
+	DIHEDRAL_ANTI_TRANSPOSE   // reflect in the anti-diagonal
+};
+
+// Quantity binned by the cell histogram descriptors
+enum histogramType
+{
+	HISTOGRAM_ORIENTATION,  // local orientation over [0,2pi), weighted by local amplitude
+	HISTOGRAM_LOCAL_PHASE   // local phase over [0,pi], weighted by local amplitude
+};
+
+// Arrangement of several outputs in a single matrix, as used by getInterleaved
+enum tensorLayout
+{
+	LAYOUT_HWC,     // interleaved: one multi-channel image with the outputs of each pixel together
+	LAYOUT_CHW      // planar: a 3D matrix (outputs x height x width) with each output contiguous
+};
+
+// Specifies the summary statistics to be found by getStatistics
+struct statisticsConfig
+{
+	std::vector<outputType> outputs;  // outputs to summarise
+	int block_size;                   // side of the square blocks for block means (0 for none)
+	int n_hist_bins;                  // number of histogram bins (0 for no histogram)
+	float hist_min, hist_max;         // range covered by the histogram bins (hist_max > hist_min)
+
+	statisticsConfig() : block_size(16), n_hist_bins(0), hist_min(0.0f), hist_max(1.0f) {}
+};
+
+// Summary statistics of one output over the image
+struct outputStatistics
+{
+	outputType output;
+	double sum, mean;
+	float min, max;
+	double nonzero_fraction;          // fraction of pixels that are not zero
+	std::vector<int> histogram;       // counts, with values outside the range in the end bins
+	float hist_min, hist_max;
+	cv::Mat block_means;              // mean of each block (partial blocks at the edges included)
+
+	// Estimates the value below which the fraction p of pixels lie from the
+	// histogram
+	float percentile(const float p) const;
+};
+
+// An edge element found by edge extraction
+struct edgel
+{
+	cv::Point2f position;   // subpixel position (x,y) in image coordinates
+	float orientation;      // local orientation in radians, as in getOrientedAsymmetry
+	float strength;         // feature asymmetry at the edge
+};
+
+// A blob found by the signed symmetry keypoint detector
+struct symmetryKeypoint
+{
+	cv::Point2f position;           // subpixel position (x,y) in image coordinates
+	float wavelength;               // interpolated wavelength at which the response peaks
+	int polarity;                   // +1 for a bright blob, -1 for a dark blob
+	float response;                 // signed feature symmetry at the peak
+	std::vector<float> descriptor;  // contrast invariant local phase descriptor
+};
+
+// Accuracy of the recursive approximation, as found by
+// validateRecursiveApproximation
+struct recursiveValidation
+{
+	double profile_rms;     // RMS difference of the approximate and exact radial filter profiles (peak of one)
+	double even_rel_rms;    // RMS difference of the even parts relative to the RMS of the exact even part
+	double odd_rel_rms;     // RMS difference of the odd parts relative to the RMS of the exact odd part
+	double fs_mean_abs;     // mean absolute difference of the feature symmetry
+	double fa_mean_abs;     // mean absolute difference of the feature asymmetry
+};
+
+// A location found by template matching
+struct templateMatch
+{
+	int template_id;        // identifier returned when the template was added
+	cv::Point location;     // position of the top left corner of the template
+	float score;            // correlation score
+};
+
 class monogenicProcessor
 {
 	public:
@@ -17,10 +158,13 @@ class monogenicProcessor
 	// You may choose the specify shape parameter of the log-Gabor filter used
 	// to calculate the monogenic signal and the threshold parameter to use for
 	// feature symmetry and asymmetry calculations
-	monogenicProcessor(const int image_size_y, const int image_size_x, const float wavelength, const float shape_sigma = 0.5, const float sym_thresh = 0.16); // constructor
+	// The padding mode controls how the image is padded for the DFT. With
+	// PADDING_NONE (or PADDING_AUTO if it chooses no padding) the outputs have
+	// exactly the size of the image
+	monogenicProcessor(const int image_size_y, const int image_size_x, const float wavelength, const float shape_sigma = 0.5, const float sym_thresh = 0.16, const paddingMode padding = PADDING_OPTIMAL); // constructor
 
 	// Reinitialise an object, parameter as in constructor
-	void initialise(const int image_size_y, const int image_size_x, const float wavelength, const float shape_sigma = 0.5, const float sym_thresh = 0.16);
+	void initialise(const int image_size_y, const int image_size_x, const float wavelength, const float shape_sigma = 0.5, const float sym_thresh = 0.16, const paddingMode padding = PADDING_OPTIMAL);
 
 	// Calculate the monogenic representation of the input image I
 	// This does not return anything, it just stores the result for use in future
@@ -29,6 +173,110 @@ class monogenicProcessor
 	// It also overwrites any previous result
 	void findMonogenicSignal(const cv::Mat &I);
 
+	// Prepares to process images of the given type with the minimum latency
+	// from the first image, by processing a blank image and finding each of
+	// the listed outputs. This allocates (and touches) every buffer that they
+	// need and starts the worker threads. Call it after initialise and any
+	// other configuration (such as the latency mode, extra filters and
+	// temporal filter). Afterwards there is no current result, and the
+	// temporal filter will start from the next image. The blank image is not
+	// included in the metrics or the stage statistics
+	void prepare(const std::vector<outputType> &outputs, const int input_type = CV_8UC1);
+
+	// An alternative to findMonogenicSignal for long wavelengths and large
+	// images, after which all the same methods may be used (except those that
+	// use the stored spectrum, i.e. registration, keypoints, denoising and
+	// template matching). The log Gabor filter is approximated by a difference
+	// of two Gaussians, each implemented by recursive filtering, and the Riesz
+	// transform by the derivative of the result scaled to be exact at the centre
+	// frequency. The cost per pixel does not depend on the wavelength. Use
+	// validateRecursiveApproximation to assess the accuracy
+	void findMonogenicSignalRecursive(const cv::Mat &I);
+
+	// Replaces the log Gabor radial profile of the band-pass filter with
+	// another profile, which is evaluated at each frequency to create the
+	// frequency domain filters. If the profile has a recursive implementation
+	// that is exact, and this is found to be faster than the DFT by timing
+	// both paths on a blank image, subsequent calls to findMonogenicSignal
+	// will use findMonogenicSignalRecursive with this profile instead. An
+	// approximate recursive implementation is only considered if
+	// allow_approximate is true, as its accuracy is not checked here (see
+	// validateRecursiveApproximation). Passing a null
+	// pointer restores the log Gabor profile. The profile is also reset by
+	// initialise
+	void setRadialProfile(const std::shared_ptr<const radialProfile> &profile, const bool allow_approximate = false);
+
+	// In latency mode, every stage of processing a single image is split
+	// across all threads: the row and column passes of each DFT (with
+	// cache-blocked transposes), the spectral multiplications, and the
+	// calculation of outputs, which are each found in one fused pass. This
+	// minimises the time per image, whereas the default mode (which only runs
+	// the filters in parallel with each other) has less overhead and suits
+	// processing many images at once. The mode is reset by initialise
+	void setLatencyMode(const bool enable);
+
+	// Starts measuring the time taken by each stage of processing (see
+	// processingStage), clearing any previous measurements. If
+	// hardware_counters is true, the Linux hardware performance counters are
+	// also read around each stage, giving the instructions per cycle, memory
+	// bandwidth and proportion of stalled cycles of each. Enable profiling
+	// after setting the number of OpenMP threads, as the counters are opened
+	// for each thread. Profiling is disabled by default
+	void enableProfiling(const bool hardware_counters = true);
+	void disableProfiling();
+
+	// Returns the measurements of each stage that has run since profiling was
+	// enabled, which may be written out with writeStageStatistics
+	void getStageStatistics(std::vector<stageStatistics> &stats) const;
+
+	// Clears the measurements without disabling profiling
+	void resetStageStatistics();
+
+	// Reports the bytes held by each buffer of the processor that is not empty.
+	// Buffers that share memory with another are not listed twice
+	void getMemoryUsage(std::vector<bufferUsage> &usage) const;
+
+	// Total bytes held by the processor's buffers
+	size_t getMemoryUsage() const;
+
+	// Sets the strategies (combined memoryStrategy flags) used to reduce the
+	// memory held. These are kept by initialise
+	void setMemoryStrategies(const int strategies);
+	int getMemoryStrategies() const;
+
+	// Estimates the bytes that will be held in steady state with the given
+	// strategies, when each image is followed by requests for the listed
+	// outputs
+	size_t estimateMemoryUsage(const int strategies, const std::vector<outputType> &outputs) const;
+
+	// Chooses the least restrictive strategies under which the estimated
+	// memory held while finding the listed outputs is within the budget, and
+	// releases any memory that they do not need. The strategies are tried in
+	// the order none, fused outputs, then also half precision filters, then
+	// also dropping the spectrum. Returns false if even the last exceeds the
+	// budget (it is used anyway)
+	bool setMemoryBudget(const size_t bytes, const std::vector<outputType> &outputs);
+
+	// Releases the cached outputs and working buffers, e.g. for a stream that
+	// is idle. If keep_result is true, the filter responses are kept so that
+	// outputs may still be found for the last image (and are recalculated when
+	// requested). Otherwise they are released too, and findMonogenicSignal must
+	// be called before requesting any output
+	void trim(const bool keep_result = true);
+
+	// Sets an object to receive metrics of long-term health: the number of
+	// images processed, the duration of each stage, the hit rate of the cached
+	// outputs and the memory held. The object may be shared between
+	// processors, and exported while they run with a metricsExporter. It is
+	// kept by initialise, and a null pointer stops the metrics
+	void setMetrics(const std::shared_ptr<processorMetrics> &processor_metrics);
+
+	// Compares the results of findMonogenicSignalRecursive on the image I to
+	// the exact result found via the DFT, even when findMonogenicSignal would
+	// use the approximation. Afterwards, the processor holds the exact result
+	// for I
+	void validateRecursiveApproximation(const cv::Mat &I, recursiveValidation &report);
+
 	// Returns the even part of the monogenic representation
 	void getEvenFilt(cv::Mat &even);
 
@@ -71,9 +319,233 @@ class monogenicProcessor
 	// local orientation
 	void getLocalPhaseVector(cv::Mat &mag, cv::Mat &lo);
 
+	// Returns the size of the DFTs used (the image size after padding), which
+	// is also the size of the outputs
+	cv::Size getTransformSize() const;
+
+	// Registers an extra filter to be applied to the spectrum of each
+	// subsequent image. The filter must have the transform size, and be real
+	// (CV_32F) or complex (CV_32FC2) with the zero frequency at the top left as
+	// for cv::dft. Its inverse DFT is performed alongside those of the even
+	// and odd filters, so the padding and forward DFT are shared. Returns an
+	// identifier for the filter
+	int addSpectralFilter(const cv::Mat &filter);
+
+	// As above, for a real isotropic filter with the given radial profile
+	int addSpectralFilter(const radialProfile &profile);
+
+	// Removes all filters added by addSpectralFilter
+	void clearSpectralFilters();
+
+	// Returns the complex-valued (two-channel) response of the image most
+	// recently passed to findMonogenicSignal to an extra filter. For a real
+	// filter symmetric about the zero frequency (such as one made from a
+	// radial profile) the response is in the real channel
+	void getSpectralFilterResult(const int id, cv::Mat &result);
+
+	// Returns any one of the outputs listed in outputType, calculating it if
+	// necessary
+	void getOutput(const outputType output, cv::Mat &result);
+
+	// Adds a template to be matched against one of the derived outputs
+	// (typically OUTPUT_FS or OUTPUT_FA) of subsequent images. The template is
+	// made zero-mean and unit-norm and its spectrum is cached, so it must be no
+	// larger than the image. Returns an identifier for the template
+	int addMatchTemplate(const cv::Mat &templ, const outputType output);
+
+	// Removes all templates added by addMatchTemplate
+	void clearMatchTemplates();
+
+	// Matches all templates against the relevant outputs of the image most
+	// recently passed to findMonogenicSignal by correlation in the frequency
+	// domain. Each output map is transformed once, and each template then
+	// costs a single inverse DFT. Returns, for each template, up to max_matches
+	// local maxima of the correlation with score above min_score, separated by
+	// at least min_separation pixels, in decreasing order of score
+	void findTemplateMatches(std::vector<templateMatch> &matches, const int max_matches = 1, const float min_score = 0.0, const int min_separation = 1);
+
+	// Returns a denoised version of the image most recently passed to
+	// findMonogenicSignal. Within the passband of the filter the image is
+	// replaced by its even part with the local amplitude shrunk by amp_thresh
+	// (soft thresholding) or zeroed where below amp_thresh (hard thresholding),
+	// which preserves local phase. The remainder of the spectrum is passed
+	// through unchanged. This costs a single inverse DFT. It needs the stored
+	// spectrum, so is not available with MEMORY_DROP_SPECTRUM or after
+	// findMonogenicSignalRecursive
+	void getDenoised(cv::Mat &denoised, const float amp_thresh, const bool soft = true);
+
+	// Extracts edges from the feature asymmetry of the image most recently
+	// passed to findMonogenicSignal. Non-maximum suppression along the local
+	// orientation and hysteresis thresholding (edges must exceed low_thresh
+	// and be connected to a pixel exceeding high_thresh) are performed in a
+	// single pass over the image rows, without calculating the full feature
+	// asymmetry and orientation images. Returns a list of edge elements with
+	// subpixel positions
+	void getEdgels(std::vector<edgel> &edgels, const float low_thresh, const float high_thresh);
+
+	// Detects bright and dark blobs in the image most recently passed to
+	// findMonogenicSignal as local maxima of the positive and negative signed
+	// feature symmetry over space and scale. Wavelengths must be positive and
+	// strictly increasing (ideally geometrically spaced, as the scale is
+	// interpolated in log wavelength), and there must be at least three. The
+	// scales are processed in turn from the stored spectrum, with the filters
+	// formed on the fly, and only a sliding window of three scales is kept in
+	// memory during the call. Maxima above thresh are returned with
+	// subpixel position and interpolated wavelength. The descriptor consists
+	// of the even part and the radial component of the odd part, normalised
+	// by local amplitude, at eight points on a circle of diameter equal to the
+	// wavelength (starting in the positive x direction)
+	void detectSymmetryKeypoints(std::vector<symmetryKeypoint> &keypoints, const std::vector<float> &wavelengths, const float thresh);
+
+	// Returns dense histogram descriptors of the image most recently passed to
+	// findMonogenicSignal. The image is divided into square cells of side
+	// cell_size (partial cells at the right and bottom are ignored), and for
+	// each cell a histogram with n_bins bins is accumulated, with each pixel
+	// contributing its local amplitude shared linearly between the two nearest
+	// bins. The result has one row per cell, in raster order, and one column
+	// per bin. The amplitude, orientation and phase are calculated on the fly
+	// from the filter responses rather than from the full output images
+	void getCellHistograms(cv::Mat &hist, const histogramType type, const int cell_size, const int n_bins);
+
+	// Returns summary statistics (sum, mean, minimum, maximum, fraction of
+	// non-zero pixels, and optionally a histogram and means over blocks) for
+	// each of the outputs listed in config, over the original image area of
+	// the image most recently passed to findMonogenicSignal. All outputs are
+	// calculated on the fly from the filter responses in a single pass,
+	// without forming or re-reading the full output images
+	void getStatistics(const statisticsConfig &config, std::vector<outputStatistics> &stats);
+
+	// Returns summed-area tables (integral images) of each of the listed
+	// outputs over the original image area of the image most recently passed
+	// to findMonogenicSignal. As with cv::integral, each table is CV_64F and
+	// one larger than the image in each dimension, with a first row and
+	// column of zeros. The outputs are calculated on the fly from the filter
+	// responses in the same row-parallel pass that forms the row sums, so the
+	// full output images are not needed. Use sumBoxes to query the tables
+	void getIntegralImages(const std::vector<outputType> &outputs, std::vector<cv::Mat> &sats);
+
+	// Enables temporal smoothing of the listed outputs. After this, each call
+	// to findMonogenicSignal updates an exponential moving average of each
+	// output, with weight alpha given to the new image, in a single pass over
+	// the filter responses. OUTPUT_ORIENTATION is averaged as a doubled-angle
+	// vector weighted by the odd magnitude, which avoids problems with the
+	// angle wrapping around, so its smoothed version is an axial orientation
+	// in [0,pi). The first image after this call initialises the averages
+	void setTemporalFilter(const std::vector<outputType> &outputs, const float alpha);
+
+	// Disables temporal smoothing and releases its state
+	void clearTemporalFilter();
+
+	// Returns the temporally smoothed version of one of the outputs
+	// listed in the last call to setTemporalFilter
+	void getTemporalOutput(const outputType output, cv::Mat &result);
+
+	// Returns an output as it would be found by passing the image most
+	// recently passed to findMonogenicSignal, transformed by one of the eight
+	// rotations and reflections, to findMonogenicSignal. The filters are
+	// isotropic, so this only requires rearranging the pixels of the
+	// existing output and, for outputs involving the direction of the odd
+	// part, transforming its components. The result covers the original image
+	// area only (so rotations by 90 degrees swap its dimensions), and is exact
+	// when the image size needs no padding for the DFT. Otherwise it differs
+	// near the image edges, where the padding lies on different sides
+	void getDihedralOutput(const dihedralTransform transform, const outputType output, cv::Mat &result);
+
+	// As above, for all eight transforms in the order of dihedralTransform
+	void getDihedralOutputs(const outputType output, std::vector<cv::Mat> &results);
+
+	// Returns the listed outputs of the image most recently passed to
+	// findMonogenicSignal within a set of equally sized crop windows, whose top
+	// left corners are given by origins. The result is a single contiguous 4D
+	// CV_32F matrix with dimensions (crops x outputs x crop height x crop
+	// width), suitable for use as a batch tensor. The crop windows must lie
+	// within the image. The full image is filtered once, so there are no
+	// boundary effects at the crop edges, and the outputs are calculated
+	// directly from the filter responses within the windows only
+	void getCropBatch(const std::vector<cv::Point> &origins, const cv::Size &crop_size, const std::vector<outputType> &outputs, cv::Mat &batch);
+
+	// Returns the listed outputs of the image most recently passed to
+	// findMonogenicSignal over the original image area in a single CV_32F
+	// matrix, in the order given (e.g. even, odd x, odd y, FS, FA and local
+	// phase for a network input). With LAYOUT_HWC the result is an image with
+	// one channel per output, and with LAYOUT_CHW it is a 3D matrix (outputs x
+	// height x width). All outputs are calculated directly from the filter
+	// responses in one parallel pass, without forming the separate output
+	// images. If the result already has the required size and type (e.g. it
+	// is a header for an inference engine's input buffer) it is written in
+	// place
+	void getInterleaved(const std::vector<outputType> &outputs, cv::Mat &result, const tensorLayout layout = LAYOUT_HWC);
+
+	// The backward (adjoint) pass, for training models that use the transform
+	// as a layer. Given the gradients of a scalar loss with respect to some of
+	// the outputs of the image most recently passed to findMonogenicSignal
+	// (one CV_32F gradient per output, of the image size or the transform
+	// size), returns the gradient of the loss with respect to the (greyscale)
+	// input image, and optionally with respect to the wavelength and shape
+	// parameter of the log Gabor filter. The chain rule is applied at each
+	// pixel to give gradients with respect to the even and odd responses,
+	// which are transformed and multiplied by the conjugates of the stored
+	// filters, and a single inverse DFT gives the input gradient. The
+	// parameter gradients are found from the same spectra and the stored
+	// spectrum of the image, without further DFTs. Where an output is not
+	// differentiable (at the thresholds of the symmetry measures and where the
+	// odd part or amplitude is zero) the gradient on the zero side is used.
+	// This is not available after findMonogenicSignalRecursive, and the
+	// parameter gradients need the log Gabor profile and the stored spectrum
+	// (so not MEMORY_DROP_SPECTRUM)
+	void backward(const std::vector<outputType> &outputs, const std::vector<cv::Mat> &output_grads, cv::Mat &input_grad, float *wavelength_grad = nullptr, float *shape_sigma_grad = nullptr);
+
+	// Stores the spectrum of the image most recently passed to
+	// findMonogenicSignal as the reference for registration
+	void setRegistrationReference();
+
+	// Stores the spectrum of the image I as the reference for registration,
+	// without altering the current monogenic representation
+	void setRegistrationReference(const cv::Mat &I);
+
+	// Estimates the translation of the image most recently passed to
+	// findMonogenicSignal relative to the registration reference by phase
+	// correlation of the monogenic signals. This reuses the stored spectra, so
+	// costs a single inverse DFT. If subpixel is true, the peak location is
+	// refined by fitting a parabola along each axis. If response is not null,
+	// the normalised peak height (between 0 and 1) is returned through it
+	cv::Point2d registerToReference(const bool subpixel = true, double *response = nullptr);
+
+	// As above, but additionally estimates the rotation (degrees, clockwise in
+	// image coordinates, ambiguous modulo 180) and scale of the image relative
+	// to the reference by phase correlation of the log-polar magnitude spectra.
+	// This costs several further DFTs. The translation estimate does not
+	// compensate for the rotation and scale, so is only reliable when these
+	// are small
+	cv::Point2d registerToReference(double &rotation, double &scale, const bool subpixel = true, double *response = nullptr);
+
 	private:
 	// Methods
-	void createLogGaborRieszFilt(void);
+	void createLogGaborRieszFilt(const float wavelength, cv::Mat &even_filt, cv::Mat &odd_filt);
+	void createRadialRieszFilt(const radialProfile &profile, cv::Mat &even_filt, cv::Mat &odd_filt);
+	bool recursiveIsCheaper(const radialProfile &profile);
+	void recursiveRiesz(const cv::Mat &even, const float w_centre, cv::Mat &odd) const;
+	void findMonogenicSignalExact(const cv::Mat &I);
+	void findSpectrum(const cv::Mat &I, cv::Mat &spectrum);
+	void findPadded(const cv::Mat &I, cv::Mat &padded);
+	void applyFilters();
+	void multiplyFilters(const cv::Mat &spectrum, const std::vector<cv::Mat*> &responses);
+	void filterSpectrumLogGabor(const float wavelength, cv::Mat &even_resp, cv::Mat &odd_resp) const;
+	void evenFilterRow(const int j, float *gains) const;
+	void compactFilters();
+	void recordFrameMetrics();
+	template<typename visitor> void visitBuffers(visitor visit) const;
+	bool outputIsValid(const outputType output) const;
+	void invalidateOutputs();
+	void choosePadding(const paddingMode padding);
+	void forwardDFT(const cv::Mat &src, cv::Mat &dst) const;
+	void inverseDFT(const cv::Mat &src, cv::Mat &dst, const bool scale) const;
+	void findLogPolarSpectrum(const cv::Mat &spectrum, cv::Mat &log_polar);
+	const cv::Mat& findOutput(const outputType output);
+	void findOutputParallel(const outputType output);
+	void updateTemporalState();
+	static float pixelOutput(const outputType output, const float e, const float o_x, const float o_y, const float T);
+	static void pixelOutputGradient(const outputType output, const float e, const float o_x, const float o_y, const float T, float &d_e, float &d_x, float &d_y);
 	void splitEven();
 	void splitOdd();
 	void findEvenMag();
@@ -89,6 +561,29 @@ class monogenicProcessor
 	bool even_valid, odd_valid, even_mag_valid, odd_mag_ori_valid, amp_valid, sym_valid, asym_valid, or_sym_valid, or_asym_valid, lp_valid;
 	cv::Mat even_filter, odd_filter;
 	cv::Mat planes[2];
+	exactDFT transform;
+	stageProfiler profiler;
+	std::shared_ptr<processorMetrics> metrics;
+	std::vector<std::pair<const uchar*,size_t>> metrics_buffers;
+	int memory_strategies;
+	cv::Mat even_gain_half;
+	cv::Mat grad_even, grad_odd;
+	cv::Mat im_spectrum, reg_ref_spectrum, reg_ref_log_polar, reg_corr, residual_im;
+	bool reg_ref_valid, reg_ref_log_polar_valid;
+	std::vector<cv::Mat> match_templ_spectra;
+	std::vector<outputType> match_templ_outputs;
+	std::vector<cv::Size> match_templ_sizes;
+	std::vector<outputType> temporal_outputs;
+	std::vector<cv::Mat> temporal_states;
+	cv::Mat temporal_ori;
+	float temporal_alpha;
+	bool temporal_initialised;
+	cv::Mat rec_smooth_1, rec_smooth_2;
+	float rec_sigma_1, rec_sigma_2, rec_gain, rec_profile_rms;
+	bool rec_fitted;
+	std::shared_ptr<const radialProfile> radial_profile;
+	std::vector<cv::Mat> spectral_filters, spectral_results;
+	bool use_recursive, latency_mode, result_recursive;
 	int ysize, xsize, pad_ysize, pad_xsize;
 	float sigma_onf, wl, T;
 
@@ -96,6 +591,14 @@ class monogenicProcessor
 
 };
 
+// Finds the sum over each of the boxes from a summed-area table produced by
+// getIntegralImages (or cv::integral with CV_64F output). Boxes must have
+// non-negative size and lie within the image (i.e. within one less than the
+// rows and columns of the table), otherwise an error is raised before any
+// sums are found. The loop over boxes is written to be vectorised by the
+// compiler using gather instructions where available
+void sumBoxes(const cv::Mat &sat, const std::vector<cv::Rect> &boxes, std::vector<double> &sums);
+
 } // end of namespace
 
 #endif
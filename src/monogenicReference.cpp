@@ -0,0 +1,344 @@
+#include "monogenicReference.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace cv;
+
+namespace monogenic
+{
+
+static const char* const C_PATTERN_NAMES[N_SYNTHETIC_PATTERNS] =
+{
+	"chirp",
+	"rings",
+	"step_edges",
+	"noise"
+};
+
+// Proportion of the maximum amplitude below which angles and symmetry
+// measures are not compared, as they are dominated by rounding there
+static const double C_MASK_FRACTION = 0.05;
+
+const char* syntheticPatternName(const syntheticPattern pattern)
+{
+	return C_PATTERN_NAMES[pattern];
+}
+
+void makeSyntheticImage(const syntheticPattern pattern, const Size &size, Mat &image, const unsigned seed)
+{
+	image.create(size,CV_32F);
+
+	if(pattern == PATTERN_NOISE)
+	{
+		RNG rng(seed);
+		rng.fill(image,RNG::NORMAL,Scalar::all(127.5),Scalar::all(40.0));
+		image = cv::min(image,255.0);
+		image = cv::max(image,0.0);
+		return;
+	}
+
+	// The chirp runs along a direction 30 degrees from the x axis, and its
+	// frequency increases linearly with distance along it
+	const double chirp_c = std::cos(CV_PI/6.0), chirp_s = std::sin(CV_PI/6.0);
+	const double chirp_length = chirp_c*size.width + chirp_s*size.height;
+	const double ring_period = 12.0;
+	const double cx = 0.5*size.width, cy = 0.5*size.height;
+	const double disc_radius = 0.25*std::min(size.width,size.height);
+
+	for(int y = 0; y < size.height; ++y)
+	{
+		float* const row = image.ptr<float>(y);
+		for(int x = 0; x < size.width; ++x)
+		{
+			double v = 0.0;
+			switch(pattern)
+			{
+				case PATTERN_CHIRP:
+				{
+					const double u = chirp_c*x + chirp_s*y;
+					v = 127.5 + 127.5*std::cos(CV_PI*0.25*u*u/chirp_length);
+					break;
+				}
+				case PATTERN_RINGS:
+				{
+					const double r = std::sqrt((x-cx)*(x-cx) + (y-cy)*(y-cy));
+					v = 127.5 + 127.5*std::cos(2.0*CV_PI*r/ring_period);
+					break;
+				}
+				case PATTERN_STEP_EDGES:
+				{
+					v = (((x/48) + (y/32)) % 2) ? 192.0 : 64.0;
+					if((x-cx)*(x-cx) + (y-cy)*(y-cy) < disc_radius*disc_radius)
+						v = 128.0;
+					break;
+				}
+				default:
+					break;
+			}
+			row[x] = float(v);
+		}
+	}
+}
+
+monogenicReference::monogenicReference(const int image_size_y, const int image_size_x, const double wavelength, const double shape_sigma, const double sym_thresh, const Size &transform_size)
+: ysize(image_size_y), xsize(image_size_x), wl(wavelength), sigma_onf(shape_sigma), T(sym_thresh)
+{
+	pad_ysize = transform_size.empty() ? ysize : transform_size.height;
+	pad_xsize = transform_size.empty() ? xsize : transform_size.width;
+	if((pad_ysize < ysize) || (pad_xsize < xsize))
+		CV_Error(cv::Error::StsBadArg,"The transform size must be at least the image size");
+	createFilters();
+}
+
+Size monogenicReference::getTransformSize() const
+{
+	return Size(pad_xsize,pad_ysize);
+}
+
+// The log Gabor filter and its Riesz transform, as defined in
+// monogenicProcessor::createLogGaborRieszFilt
+void monogenicReference::createFilters()
+{
+	const double w0 = 1.0/wl;
+	const double scale_const = 1.0/(2.0*std::log(sigma_onf)*std::log(sigma_onf));
+	const int xswitch = (pad_xsize + 1)/2;
+	const int yswitch = (pad_ysize + 1)/2;
+
+	even_filter = Mat::zeros(pad_ysize,pad_xsize,CV_64FC2);
+	odd_filter = Mat::zeros(pad_ysize,pad_xsize,CV_64FC2);
+
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		Vec2d* const even_ptr = even_filter.ptr<Vec2d>(j);
+		Vec2d* const odd_ptr = odd_filter.ptr<Vec2d>(j);
+		const double w_y = (j < yswitch) ? -double(j)/pad_ysize : double(pad_ysize - j)/pad_ysize;
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			const double w_x = (i < xswitch) ? double(i)/pad_xsize : double(i - pad_xsize)/pad_xsize;
+			const double w = std::sqrt(w_x*w_x + w_y*w_y);
+
+			// Zero frequency, and the unpaired highest frequency of an even
+			// dimension
+			if(((i == 0) && (j == 0)) || ((pad_xsize % 2 == 0) && (i == xswitch)) || ((pad_ysize % 2 == 0) && (j == yswitch)))
+				continue;
+
+			const double l = std::log(w/w0);
+			const double f = std::exp(-l*l*scale_const);
+			even_ptr[i][0] = f;
+			odd_ptr[i][0] = -f*w_y/w;
+			odd_ptr[i][1] = f*w_x/w;
+		}
+	}
+}
+
+void monogenicReference::findMonogenicSignal(const Mat &I)
+{
+	Mat grey, padded;
+	if(I.channels() == 3)
+		cvtColor(I,grey,cv::COLOR_BGR2GRAY);
+	else
+		grey = I;
+	copyMakeBorder(grey,padded,0,pad_ysize - ysize,0,pad_xsize - xsize,BORDER_CONSTANT,Scalar::all(0));
+
+	Mat planes[2];
+	padded.convertTo(planes[0],CV_64F);
+	planes[1] = Mat::zeros(pad_ysize,pad_xsize,CV_64F);
+	Mat spectrum;
+	merge(planes,2,spectrum);
+	dft(spectrum,spectrum);
+
+	Mat even_spectrum(pad_ysize,pad_xsize,CV_64FC2), odd_spectrum(pad_ysize,pad_xsize,CV_64FC2);
+	for(int j = 0; j < pad_ysize; ++j)
+	{
+		const Vec2d* const s_ptr = spectrum.ptr<Vec2d>(j);
+		const Vec2d* const he_ptr = even_filter.ptr<Vec2d>(j);
+		const Vec2d* const ho_ptr = odd_filter.ptr<Vec2d>(j);
+		Vec2d* const e_ptr = even_spectrum.ptr<Vec2d>(j);
+		Vec2d* const o_ptr = odd_spectrum.ptr<Vec2d>(j);
+		for(int i = 0; i < pad_xsize; ++i)
+		{
+			e_ptr[i] = Vec2d(s_ptr[i][0]*he_ptr[i][0] - s_ptr[i][1]*he_ptr[i][1], s_ptr[i][0]*he_ptr[i][1] + s_ptr[i][1]*he_ptr[i][0]);
+			o_ptr[i] = Vec2d(s_ptr[i][0]*ho_ptr[i][0] - s_ptr[i][1]*ho_ptr[i][1], s_ptr[i][0]*ho_ptr[i][1] + s_ptr[i][1]*ho_ptr[i][0]);
+		}
+	}
+
+	idft(even_spectrum,even_im,DFT_SCALE);
+	idft(odd_spectrum,odd_im,DFT_SCALE);
+}
+
+double monogenicReference::pixelOutput(const outputType output, const double e, const double o_x, const double o_y, const double T)
+{
+	const double o_mag = std::sqrt(o_x*o_x + o_y*o_y);
+	const double a = std::sqrt(e*e + o_x*o_x + o_y*o_y);
+	switch(output)
+	{
+		case OUTPUT_EVEN:
+			return e;
+		case OUTPUT_ODD_X:
+			return o_x;
+		case OUTPUT_ODD_Y:
+			return o_y;
+		case OUTPUT_ODD_MAG:
+			return o_mag;
+		case OUTPUT_ORIENTATION:
+		{
+			const double angle = std::atan2(o_y,o_x);
+			return (angle < 0.0) ? angle + 2.0*CV_PI : angle;
+		}
+		case OUTPUT_AMPLITUDE:
+			return a;
+		case OUTPUT_FS:
+			return std::max(std::abs(e) - o_mag - T,0.0) / (a + C_EPSILON);
+		case OUTPUT_FA:
+			return std::max(o_mag - std::abs(e) - T,0.0) / (a + C_EPSILON);
+		case OUTPUT_POS_FS:
+			return std::max(std::max(e,0.0) - o_mag - T,0.0) / (a + C_EPSILON);
+		case OUTPUT_NEG_FS:
+			return std::max(std::max(-e,0.0) - o_mag - T,0.0) / (a + C_EPSILON);
+		case OUTPUT_LOCAL_PHASE:
+			return std::atan2(o_mag,e);
+	}
+	CV_Error(cv::Error::StsBadArg,"Unknown output type");
+}
+
+void monogenicReference::getOutput(const outputType output, Mat &result) const
+{
+	if(even_im.empty())
+		CV_Error(cv::Error::StsError,"No image has been processed");
+
+	result.create(ysize,xsize,CV_64F);
+	for(int j = 0; j < ysize; ++j)
+	{
+		const Vec2d* const e_ptr = even_im.ptr<Vec2d>(j);
+		const Vec2d* const o_ptr = odd_im.ptr<Vec2d>(j);
+		double* const out_ptr = result.ptr<double>(j);
+		for(int i = 0; i < xsize; ++i)
+			out_ptr[i] = pixelOutput(output,e_ptr[i][0],o_ptr[i][0],o_ptr[i][1],T);
+	}
+}
+
+errorBound documentedErrorBound(const accuracyClass accuracy, const outputType output)
+{
+	// Bounds for the linear outputs, angles and symmetry measures in turn. The
+	// maximum errors of the angles and symmetry measures of the recursive
+	// approximation are not checked, as any bound large enough to hold at
+	// every pixel would be no smaller than the range of the output (pi for a
+	// wrapped angle, one for symmetry)
+	const double unchecked = std::numeric_limits<double>::infinity();
+	const errorBound C_BOUNDS[3][3] =
+	{
+		{ {2e-4,3e-5}, {6e-3,2e-3},      {1e-3,1e-4} },      // ACCURACY_SINGLE_PRECISION
+		{ {2e-3,3e-4}, {2e-2,3e-3},      {1e-2,1e-3} },      // ACCURACY_HALF_PRECISION_FILTERS
+		{ {0.5,0.15},  {unchecked,0.6},  {unchecked,0.2} }   // ACCURACY_RECURSIVE
+	};
+
+	int kind = 0;
+	switch(output)
+	{
+		case OUTPUT_EVEN:
+		case OUTPUT_ODD_X:
+		case OUTPUT_ODD_Y:
+		case OUTPUT_ODD_MAG:
+		case OUTPUT_AMPLITUDE:
+			kind = 0;
+			break;
+		case OUTPUT_ORIENTATION:
+		case OUTPUT_LOCAL_PHASE:
+			kind = 1;
+			break;
+		case OUTPUT_FS:
+		case OUTPUT_FA:
+		case OUTPUT_POS_FS:
+		case OUTPUT_NEG_FS:
+			kind = 2;
+			break;
+	}
+	return C_BOUNDS[accuracy][kind];
+}
+
+void measureOutputError(const monogenicReference &reference, const outputType output, const Mat &result, double &max_error, double &rms_error)
+{
+	Mat ref_out, ref_amp, ref_odd_mag;
+	reference.getOutput(output,ref_out);
+	reference.getOutput(OUTPUT_AMPLITUDE,ref_amp);
+	reference.getOutput(OUTPUT_ODD_MAG,ref_odd_mag);
+
+	if(result.empty() || (result.rows < ref_out.rows) || (result.cols < ref_out.cols))
+		CV_Error(cv::Error::StsBadArg,"The result is smaller than the image");
+
+	Mat fast;
+	result(Rect(0,0,ref_out.cols,ref_out.rows)).convertTo(fast,CV_64F);
+
+	double amp_max = 0.0;
+	minMaxLoc(ref_amp,nullptr,&amp_max);
+	if(amp_max <= 0.0) amp_max = 1.0;
+	const double mask_level = C_MASK_FRACTION*amp_max;
+
+	double sum_sq = 0.0;
+	long count = 0;
+	max_error = 0.0;
+	for(int j = 0; j < ref_out.rows; ++j)
+	{
+		const double* const ref_ptr = ref_out.ptr<double>(j);
+		const double* const fast_ptr = fast.ptr<double>(j);
+		const double* const amp_ptr = ref_amp.ptr<double>(j);
+		const double* const odd_mag_ptr = ref_odd_mag.ptr<double>(j);
+		for(int i = 0; i < ref_out.cols; ++i)
+		{
+			double error;
+			switch(output)
+			{
+				case OUTPUT_EVEN:
+				case OUTPUT_ODD_X:
+				case OUTPUT_ODD_Y:
+				case OUTPUT_ODD_MAG:
+				case OUTPUT_AMPLITUDE:
+					error = std::abs(fast_ptr[i] - ref_ptr[i])/amp_max;
+					break;
+				case OUTPUT_ORIENTATION:
+					if(odd_mag_ptr[i] <= mask_level) continue;
+					error = std::abs(std::remainder(fast_ptr[i] - ref_ptr[i],2.0*CV_PI));
+					break;
+				case OUTPUT_LOCAL_PHASE:
+					if(amp_ptr[i] <= mask_level) continue;
+					error = std::abs(std::remainder(fast_ptr[i] - ref_ptr[i],2.0*CV_PI));
+					break;
+				default:
+					if(amp_ptr[i] <= mask_level) continue;
+					error = std::abs(fast_ptr[i] - ref_ptr[i]);
+					break;
+			}
+			max_error = std::max(max_error,error);
+			sum_sq += error*error;
+			++count;
+		}
+	}
+	rms_error = (count > 0) ? std::sqrt(sum_sq/count) : 0.0;
+}
+
+bool compareWithReference(monogenicProcessor &processor, const monogenicReference &reference, const vector<outputType> &outputs, const accuracyClass accuracy, vector<referenceComparison> &results)
+{
+	if(processor.getTransformSize() != reference.getTransformSize())
+		CV_Error(cv::Error::StsBadArg,"The processor and reference must use the same transform size");
+
+	bool all_passed = true;
+	results.clear();
+	for(size_t k = 0; k < outputs.size(); ++k)
+	{
+		referenceComparison comparison;
+		comparison.output = outputs[k];
+		Mat result;
+		processor.getOutput(outputs[k],result);
+		measureOutputError(reference,outputs[k],result,comparison.max_error,comparison.rms_error);
+		comparison.bound = documentedErrorBound(accuracy,outputs[k]);
+		comparison.passed = (comparison.max_error <= comparison.bound.max_error) && (comparison.rms_error <= comparison.bound.rms_error);
+		all_passed = all_passed && comparison.passed;
+		results.push_back(comparison);
+	}
+	return all_passed;
+}
+
+} // end of namespace
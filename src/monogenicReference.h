@@ -0,0 +1,115 @@
+#ifndef MONOGENICREFERENCE_H
+#define MONOGENICREFERENCE_H
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include "monogenicProcessor.h"
+
+namespace monogenic
+{
+
+// Synthetic test images, chosen to exercise all orientations, a range of
+// frequencies and both symmetric and antisymmetric features
+enum syntheticPattern
+{
+	PATTERN_CHIRP,          // oblique linear chirp, from zero to a quarter cycle per pixel
+	PATTERN_RINGS,          // concentric rings
+	PATTERN_STEP_EDGES,     // rectangles of two grey levels and a disc
+	PATTERN_NOISE,          // Gaussian white noise
+	N_SYNTHETIC_PATTERNS
+};
+
+// Name of a pattern as used in reports (e.g. "step_edges")
+const char* syntheticPatternName(const syntheticPattern pattern);
+
+// Creates one of the synthetic images as CV_32F with values between 0 and
+// 255. The seed is only used by PATTERN_NOISE
+void makeSyntheticImage(const syntheticPattern pattern, const cv::Size &size, cv::Mat &image, const unsigned seed = 1);
+
+// A straightforward double precision implementation of the log Gabor
+// monogenic filters, for checking the results of monogenicProcessor. The
+// filters are built directly from their definitions, the responses are found
+// with cv::dft on CV_64FC2 images and each output is found from the
+// responses at each pixel with the exact functions of the standard library.
+// Nothing is cached or fused, so it is slow, and is intended only as an
+// oracle for tests
+class monogenicReference
+{
+	public:
+
+	// Parameters as for monogenicProcessor. The transform size should be that
+	// of the processor being checked (see monogenicProcessor::getTransformSize)
+	// so that the padding is the same. An empty size means no padding
+	monogenicReference(const int image_size_y, const int image_size_x, const double wavelength, const double shape_sigma = 0.5, const double sym_thresh = 0.16, const cv::Size &transform_size = cv::Size());
+
+	// Finds the filter responses of the image I
+	void findMonogenicSignal(const cv::Mat &I);
+
+	// Returns one of the outputs over the original image area as CV_64F
+	void getOutput(const outputType output, cv::Mat &result) const;
+
+	cv::Size getTransformSize() const;
+
+	private:
+
+	void createFilters();
+	static double pixelOutput(const outputType output, const double e, const double o_x, const double o_y, const double T);
+
+	cv::Mat even_filter, odd_filter, even_im, odd_im;
+	int ysize, xsize, pad_ysize, pad_xsize;
+	double wl, sigma_onf, T;
+
+	static constexpr double C_EPSILON = 0.0001; // as in monogenicProcessor
+};
+
+// Types of fast path, which differ in their documented accuracy
+enum accuracyClass
+{
+	ACCURACY_SINGLE_PRECISION,          // single precision filters and responses (all padding modes, latency mode, fused outputs, dropped spectrum)
+	ACCURACY_HALF_PRECISION_FILTERS,    // MEMORY_HALF_FILTERS
+	ACCURACY_RECURSIVE                  // findMonogenicSignalRecursive (a check for gross errors only, see documentedErrorBound)
+};
+
+// Permitted maximum and root mean square errors of one output
+struct errorBound
+{
+	double max_error, rms_error;
+};
+
+// Returns the documented error bound of an output for a class of fast path.
+// Errors are measured over the original image area, as follows:
+// - even and odd parts, odd magnitude and amplitude: absolute error relative
+//   to the maximum amplitude of the reference
+// - orientation: wrapped angular error (radians) where the odd magnitude of
+//   the reference exceeds 5% of its maximum amplitude
+// - local phase: angular error (radians) where the amplitude exceeds 5% of
+//   its maximum
+// - feature symmetry and its variants: absolute error where the amplitude
+//   exceeds 5% of its maximum
+// The single precision bounds allow for the approximate arctangent of
+// cv::cartToPolar and cv::phase (about 0.3 degrees). For ACCURACY_RECURSIVE,
+// only the RMS errors of the angles and symmetry measures are checked, and
+// their maximum errors are given as infinity
+errorBound documentedErrorBound(const accuracyClass accuracy, const outputType output);
+
+// Result of comparing one output with the reference
+struct referenceComparison
+{
+	outputType output;
+	double max_error, rms_error;
+	errorBound bound;
+	bool passed;
+};
+
+// Measures the error of one output (of at least the original image size)
+// against the reference, as described for documentedErrorBound
+void measureOutputError(const monogenicReference &reference, const outputType output, const cv::Mat &result, double &max_error, double &rms_error);
+
+// Compares each of the listed outputs of the processor with those of the
+// reference, both of which must have processed the same image, against the
+// documented bounds. Returns true if every output is within its bounds
+bool compareWithReference(monogenicProcessor &processor, const monogenicReference &reference, const std::vector<outputType> &outputs, const accuracyClass accuracy, std::vector<referenceComparison> &results);
+
+} // end of namespace
+
+#endif
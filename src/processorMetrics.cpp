@@ -0,0 +1,309 @@
+#include "processorMetrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define MONOGENIC_HAVE_SOCKETS
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+using namespace std;
+
+namespace monogenic
+{
+
+const double processorMetrics::C_BUCKET_BOUNDS[processorMetrics::C_N_BUCKETS] =
+	{0.0001,0.00025,0.0005,0.001,0.0025,0.005,0.01,0.025,0.05,0.1,0.25,0.5,1.0,2.5};
+
+// Time between checks of the stop flag by the background thread
+static const int C_POLL_MS = 200;
+
+// Escape a label value as required by the text format
+static string escapeLabel(const string &value)
+{
+	string escaped;
+	for(size_t k = 0; k < value.size(); ++k)
+	{
+		if(value[k] == '\\') escaped += "\\\\";
+		else if(value[k] == '"') escaped += "\\\"";
+		else if(value[k] == '\n') escaped += "\\n";
+		else escaped += value[k];
+	}
+	return escaped;
+}
+
+// Bucket bounds in the canonical form of floating point values (e.g. "1.0"
+// rather than "1")
+static string formatBound(const double bound)
+{
+	ostringstream os;
+	os << bound;
+	string text = os.str();
+	if(text.find_first_of(".e") == string::npos)
+		text += ".0";
+	return text;
+}
+
+processorMetrics::processorMetrics(const string &label)
+: label(label), frames(0), dropped(0), cache_hits(0), cache_misses(0), memory_bytes(0), queue_depth(0)
+{
+	for(int s = 0; s < N_PROCESSING_STAGES; ++s)
+	{
+		stage_ns[s].store(0);
+		for(int b = 0; b <= C_N_BUCKETS; ++b)
+			bucket_counts[s][b].store(0);
+	}
+}
+
+void processorMetrics::recordFrame()
+{
+	frames.fetch_add(1,std::memory_order_relaxed);
+}
+
+void processorMetrics::recordStage(const processingStage stage, const double ms)
+{
+	const double seconds = 0.001*ms;
+	int b = 0;
+	while((b < C_N_BUCKETS) && (seconds > C_BUCKET_BOUNDS[b]))
+		++b;
+	bucket_counts[stage][b].fetch_add(1,std::memory_order_relaxed);
+	stage_ns[stage].fetch_add(uint64_t(1e6*ms),std::memory_order_relaxed);
+}
+
+void processorMetrics::recordCacheAccess(const bool hit)
+{
+	(hit ? cache_hits : cache_misses).fetch_add(1,std::memory_order_relaxed);
+}
+
+void processorMetrics::setMemoryBytes(const uint64_t bytes)
+{
+	memory_bytes.store(bytes,std::memory_order_relaxed);
+}
+
+void processorMetrics::setQueueDepth(const int64_t depth)
+{
+	queue_depth.store(depth,std::memory_order_relaxed);
+}
+
+void processorMetrics::recordDroppedFrames(const uint64_t n)
+{
+	dropped.fetch_add(n,std::memory_order_relaxed);
+}
+
+uint64_t processorMetrics::framesProcessed() const
+{
+	return frames.load(std::memory_order_relaxed);
+}
+
+// The values are read individually, so a snapshot taken while processing may
+// be slightly inconsistent between metrics, as is usual for scraped metrics
+void processorMetrics::writeOpenMetrics(ostream &os) const
+{
+	const string base_label = label.empty() ? "" : "processor=\"" + escapeLabel(label) + "\"";
+	const string labels = base_label.empty() ? "" : "{" + base_label + "}";
+	const string stage_prefix = base_label.empty() ? "{" : "{" + base_label + ",";
+
+	os << "# TYPE monogenic_frames counter\n"
+	   << "# HELP monogenic_frames Images processed.\n"
+	   << "monogenic_frames_total" << labels << " " << frames.load(std::memory_order_relaxed) << "\n";
+	os << "# TYPE monogenic_dropped_frames counter\n"
+	   << "# HELP monogenic_dropped_frames Images dropped by the application.\n"
+	   << "monogenic_dropped_frames_total" << labels << " " << dropped.load(std::memory_order_relaxed) << "\n";
+	os << "# TYPE monogenic_queue_depth gauge\n"
+	   << "# HELP monogenic_queue_depth Images waiting to be processed, as reported by the application.\n"
+	   << "monogenic_queue_depth" << labels << " " << queue_depth.load(std::memory_order_relaxed) << "\n";
+	os << "# TYPE monogenic_output_cache_hits counter\n"
+	   << "# HELP monogenic_output_cache_hits Requests for outputs that had already been calculated.\n"
+	   << "monogenic_output_cache_hits_total" << labels << " " << cache_hits.load(std::memory_order_relaxed) << "\n";
+	os << "# TYPE monogenic_output_cache_misses counter\n"
+	   << "# HELP monogenic_output_cache_misses Requests for outputs that had to be calculated.\n"
+	   << "monogenic_output_cache_misses_total" << labels << " " << cache_misses.load(std::memory_order_relaxed) << "\n";
+	os << "# TYPE monogenic_memory_bytes gauge\n"
+	   << "# HELP monogenic_memory_bytes Memory held by the processor's images.\n"
+	   << "monogenic_memory_bytes" << labels << " " << memory_bytes.load(std::memory_order_relaxed) << "\n";
+
+	os << "# TYPE monogenic_stage_latency_seconds histogram\n"
+	   << "# HELP monogenic_stage_latency_seconds Time taken by each stage of processing.\n";
+	for(int s = 0; s < N_PROCESSING_STAGES; ++s)
+	{
+		const string stage_labels = stage_prefix + "stage=\"" + stageName(processingStage(s)) + "\"";
+		uint64_t cumulative = 0;
+		for(int b = 0; b <= C_N_BUCKETS; ++b)
+		{
+			cumulative += bucket_counts[s][b].load(std::memory_order_relaxed);
+			os << "monogenic_stage_latency_seconds_bucket" << stage_labels << ",le=\"";
+			if(b < C_N_BUCKETS) os << formatBound(C_BUCKET_BOUNDS[b]);
+			else os << "+Inf";
+			os << "\"} " << cumulative << "\n";
+		}
+		os << "monogenic_stage_latency_seconds_sum" << stage_labels << "} " << 1e-9*double(stage_ns[s].load(std::memory_order_relaxed)) << "\n";
+		os << "monogenic_stage_latency_seconds_count" << stage_labels << "} " << cumulative << "\n";
+	}
+
+	os << "# EOF\n";
+}
+
+string processorMetrics::openMetricsText() const
+{
+	ostringstream os;
+	writeOpenMetrics(os);
+	return os.str();
+}
+
+bool writeOpenMetricsFile(const string &path, const string &text)
+{
+	const string temp_path = path + ".tmp";
+	{
+		ofstream file(temp_path.c_str(),ios::out | ios::trunc);
+		if(!file) return false;
+		file << text;
+		if(!file) return false;
+	}
+	return std::rename(temp_path.c_str(),path.c_str()) == 0;
+}
+
+metricsExporter::metricsExporter(const std::shared_ptr<const processorMetrics> &metrics)
+: source(metrics), stopping(false)
+{
+}
+
+metricsExporter::~metricsExporter()
+{
+	stop();
+}
+
+void metricsExporter::stop()
+{
+	stopping = true;
+	if(worker.joinable())
+		worker.join();
+}
+
+void metricsExporter::startCallback(const std::function<void(const string&)> &callback, const double period_s)
+{
+	stop();
+	stopping = false;
+	worker = std::thread(&metricsExporter::runPeriodic,this,callback,period_s);
+}
+
+void metricsExporter::startFile(const string &path, const double period_s)
+{
+	startCallback([path](const string &text){ writeOpenMetricsFile(path,text); },period_s);
+}
+
+// Publish immediately and then after each period, checking for a stop request
+// frequently
+void metricsExporter::runPeriodic(const std::function<void(const string&)> callback, const double period_s)
+{
+	const auto period = std::chrono::duration<double>(period_s);
+	auto next = std::chrono::steady_clock::now();
+	while(!stopping)
+	{
+		if(std::chrono::steady_clock::now() >= next)
+		{
+			callback(source->openMetricsText());
+			next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(std::min(C_POLL_MS,int(1000.0*period_s) + 1)));
+	}
+}
+
+bool metricsExporter::startHttp(const int port, const string &address)
+{
+	stop();
+	#ifdef MONOGENIC_HAVE_SOCKETS
+	const int listen_fd = socket(AF_INET,SOCK_STREAM,0);
+	if(listen_fd < 0) return false;
+
+	const int reuse = 1;
+	setsockopt(listen_fd,SOL_SOCKET,SO_REUSEADDR,&reuse,sizeof(reuse));
+
+	sockaddr_in addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if((inet_pton(AF_INET,address.c_str(),&addr.sin_addr) != 1)
+		|| (bind(listen_fd,reinterpret_cast<sockaddr*>(&addr),sizeof(addr)) != 0)
+		|| (listen(listen_fd,4) != 0))
+	{
+		close(listen_fd);
+		return false;
+	}
+
+	stopping = false;
+	worker = std::thread(&metricsExporter::runHttp,this,listen_fd);
+	return true;
+	#else
+	(void) port;
+	(void) address;
+	return false;
+	#endif
+}
+
+// A minimal HTTP/1.1 server handling one request per connection
+void metricsExporter::runHttp(const int listen_fd)
+{
+	#ifdef MONOGENIC_HAVE_SOCKETS
+	while(!stopping)
+	{
+		pollfd pfd;
+		pfd.fd = listen_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if(poll(&pfd,1,C_POLL_MS) <= 0)
+			continue;
+
+		const int conn_fd = accept(listen_fd,nullptr,nullptr);
+		if(conn_fd < 0)
+			continue;
+
+		// Wait a short time for the request line
+		timeval timeout;
+		timeout.tv_sec = 1;
+		timeout.tv_usec = 0;
+		setsockopt(conn_fd,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+		char request[1024];
+		const ssize_t n_read = recv(conn_fd,request,sizeof(request)-1,0);
+		const string request_line(request,(n_read > 0) ? n_read : 0);
+
+		string status = "404 Not Found", content_type = "text/plain", body = "Not found\n";
+		if((request_line.compare(0,13,"GET /metrics ") == 0) || (request_line.compare(0,6,"GET / ") == 0))
+		{
+			status = "200 OK";
+			content_type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+			body = source->openMetricsText();
+		}
+
+		ostringstream response;
+		response << "HTTP/1.1 " << status << "\r\n"
+		         << "Content-Type: " << content_type << "\r\n"
+		         << "Content-Length: " << body.size() << "\r\n"
+		         << "Connection: close\r\n\r\n" << body;
+		const string text = response.str();
+		size_t sent = 0;
+		while(sent < text.size())
+		{
+			const ssize_t n = send(conn_fd,text.data() + sent,text.size() - sent,MSG_NOSIGNAL);
+			if(n <= 0) break;
+			sent += n;
+		}
+		close(conn_fd);
+	}
+	close(listen_fd);
+	#else
+	(void) listen_fd;
+	#endif
+}
+
+} // end of namespace
@@ -0,0 +1,103 @@
+#ifndef PROCESSORMETRICS_H
+#define PROCESSORMETRICS_H
+#include "stageProfiler.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace monogenic
+{
+
+// Counters and latency histograms describing the health of one or more
+// processors over a long run. Every update is a relaxed atomic operation, so
+// processors on several threads may share one object, and it may be exported
+// from another thread while they run. Queue depth and dropped frames are not
+// known to the processor, and are reported by the application
+class processorMetrics
+{
+	public:
+
+	// The label is added to every metric as processor="label" if not empty
+	explicit processorMetrics(const std::string &label = "");
+
+	// Updates made by the processor
+	void recordFrame();
+	void recordStage(const processingStage stage, const double ms);
+	void recordCacheAccess(const bool hit);
+	void setMemoryBytes(const uint64_t bytes);
+
+	// Updates made by the application
+	void setQueueDepth(const int64_t depth);
+	void recordDroppedFrames(const uint64_t n = 1);
+
+	uint64_t framesProcessed() const;
+
+	// Writes all metrics in the OpenMetrics text format (ending with "# EOF")
+	void writeOpenMetrics(std::ostream &os) const;
+	std::string openMetricsText() const;
+
+	// Upper bounds (seconds) of the latency histogram buckets, apart from the
+	// final +Inf bucket
+	static const int C_N_BUCKETS = 14;
+	static const double C_BUCKET_BOUNDS[C_N_BUCKETS];
+
+	private:
+
+	processorMetrics(const processorMetrics&);
+	processorMetrics& operator=(const processorMetrics&);
+
+	std::string label;
+	std::atomic<uint64_t> frames, dropped, cache_hits, cache_misses, memory_bytes;
+	std::atomic<int64_t> queue_depth;
+	std::atomic<uint64_t> bucket_counts[N_PROCESSING_STAGES][C_N_BUCKETS+1];
+	std::atomic<uint64_t> stage_ns[N_PROCESSING_STAGES];
+};
+
+// Publishes metrics periodically to a callback or a file, or serves them over
+// HTTP on request (GET /metrics), from a background thread. Only one method
+// of publishing may be active at a time
+class metricsExporter
+{
+	public:
+
+	explicit metricsExporter(const std::shared_ptr<const processorMetrics> &metrics);
+	~metricsExporter();
+
+	// Passes the text to the callback every period_s seconds
+	void startCallback(const std::function<void(const std::string&)> &callback, const double period_s = 10.0);
+
+	// Replaces the file with the text every period_s seconds. The file is
+	// written under a temporary name and renamed, so readers never see a
+	// partial file
+	void startFile(const std::string &path, const double period_s = 10.0);
+
+	// Listens on the given address and port (Linux and other POSIX systems
+	// only). Returns false if the socket could not be opened
+	bool startHttp(const int port, const std::string &address = "127.0.0.1");
+
+	// Stops publishing and waits for the thread to finish
+	void stop();
+
+	private:
+
+	metricsExporter(const metricsExporter&);
+	metricsExporter& operator=(const metricsExporter&);
+
+	void runPeriodic(const std::function<void(const std::string&)> callback, const double period_s);
+	void runHttp(const int listen_fd);
+
+	std::shared_ptr<const processorMetrics> source;
+	std::thread worker;
+	std::atomic<bool> stopping;
+};
+
+// Writes the text to the file via a temporary file and a rename
+bool writeOpenMetricsFile(const std::string &path, const std::string &text);
+
+} // end of namespace
+
+#endif
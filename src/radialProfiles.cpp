@@ -0,0 +1,151 @@
+#include "radialProfiles.h"
+#include "recursiveFilters.h"
+
+using namespace std;
+using namespace cv;
+
+namespace monogenic
+{
+
+// Each recursive Gaussian makes forward and backward passes along rows and
+// columns, with seven operations per pixel in each
+static const float C_RECURSIVE_GAUSSIAN_COST = 28.0f;
+
+// Difference of two recursive Gaussians of an image, scaled by gain
+static void recursiveDoG(Mat &im, const float sigma_1, const float sigma_2, const float gain)
+{
+	Mat wide = im.clone();
+
+	#pragma omp parallel sections
+	{
+		#pragma omp section
+		recursiveGaussian(im,sigma_1);
+		#pragma omp section
+		recursiveGaussian(wide,sigma_2);
+	}
+
+	im = gain*(im - wide);
+}
+
+// Profiles without a recursive implementation
+void radialProfile::applyRecursive(Mat &) const
+{
+	CV_Error(cv::Error::StsNotImplemented,"This radial profile has no recursive implementation");
+}
+
+// Log Gabor
+logGaborProfile::logGaborProfile(const float wavelength, const float shape_sigma)
+{
+	w0 = 1.0/wavelength;
+	scale_const = 1.0/(2.0*std::log(shape_sigma)*std::log(shape_sigma));
+	fitDoGToLogGabor(wavelength,shape_sigma,dog_sigma_1,dog_sigma_2,dog_gain,dog_rms);
+}
+
+float logGaborProfile::response(const float w) const
+{
+	return (w > 0.0f) ? std::exp(-std::pow(std::log(w/w0),2.0f)*scale_const) : 0.0f;
+}
+
+float logGaborProfile::centreFrequency() const
+{
+	return w0;
+}
+
+float logGaborProfile::recursiveCostPerPixel() const
+{
+	return 2.0f*C_RECURSIVE_GAUSSIAN_COST + 2.0f;
+}
+
+void logGaborProfile::applyRecursive(Mat &im) const
+{
+	recursiveDoG(im,dog_sigma_1,dog_sigma_2,dog_gain);
+}
+
+// Poisson
+poissonProfile::poissonProfile(const float scale)
+{
+	s = scale;
+}
+
+float poissonProfile::response(const float w) const
+{
+	return std::exp(-2.0f*float(CV_PI)*s*w);
+}
+
+float poissonProfile::centreFrequency() const
+{
+	return 1.0f/(2.0f*float(CV_PI)*s);
+}
+
+// Difference of Poisson. The peak of exp(-a.w) - exp(-b.w) is at
+// w = log(b/a)/(b - a)
+differenceOfPoissonProfile::differenceOfPoissonProfile(const float scale_1, const float scale_2)
+{
+	s1 = scale_1;
+	s2 = scale_2;
+	const float a = 2.0f*float(CV_PI)*s1, b = 2.0f*float(CV_PI)*s2;
+	w_peak = std::log(b/a)/(b - a);
+	gain = 1.0f/(std::exp(-a*w_peak) - std::exp(-b*w_peak));
+}
+
+float differenceOfPoissonProfile::response(const float w) const
+{
+	return gain*(std::exp(-2.0f*float(CV_PI)*s1*w) - std::exp(-2.0f*float(CV_PI)*s2*w));
+}
+
+float differenceOfPoissonProfile::centreFrequency() const
+{
+	return w_peak;
+}
+
+// Cauchy
+cauchyProfile::cauchyProfile(const float wavelength, const float order)
+{
+	w0 = 1.0f/wavelength;
+	a = order;
+}
+
+float cauchyProfile::response(const float w) const
+{
+	return std::pow(w/w0,a)*std::exp(-a*(w/w0 - 1.0f));
+}
+
+float cauchyProfile::centreFrequency() const
+{
+	return w0;
+}
+
+// Difference of Gaussians. The Gaussian with standard deviation s has
+// frequency response exp(-2.pi^2.s^2.w^2), and the peak of the difference is
+// at w^2 = log(s2^2/s1^2) / (2.pi^2.(s2^2 - s1^2))
+differenceOfGaussiansProfile::differenceOfGaussiansProfile(const float sigma_1, const float sigma_2)
+{
+	sigma1 = sigma_1;
+	sigma2 = sigma_2;
+	const float two_pi_sq = 2.0f*float(CV_PI*CV_PI);
+	w_peak = std::sqrt(std::log(sigma2*sigma2/(sigma1*sigma1)) / (two_pi_sq*(sigma2*sigma2 - sigma1*sigma1)));
+	gain = 1.0f/(std::exp(-two_pi_sq*sigma1*sigma1*w_peak*w_peak) - std::exp(-two_pi_sq*sigma2*sigma2*w_peak*w_peak));
+}
+
+float differenceOfGaussiansProfile::response(const float w) const
+{
+	const float two_pi_sq = 2.0f*float(CV_PI*CV_PI);
+	return gain*(std::exp(-two_pi_sq*sigma1*sigma1*w*w) - std::exp(-two_pi_sq*sigma2*sigma2*w*w));
+}
+
+float differenceOfGaussiansProfile::centreFrequency() const
+{
+	return w_peak;
+}
+
+float differenceOfGaussiansProfile::recursiveCostPerPixel() const
+{
+	return 2.0f*C_RECURSIVE_GAUSSIAN_COST + 2.0f;
+}
+
+void differenceOfGaussiansProfile::applyRecursive(Mat &im) const
+{
+	recursiveDoG(im,sigma1,sigma2,gain);
+}
+
+} // end of namespace
@@ -0,0 +1,120 @@
+#ifndef RADIALPROFILES_H
+#define RADIALPROFILES_H
+#include <opencv2/core/core.hpp>
+
+namespace monogenic
+{
+
+// Interface for the radial profile of the band-pass filter used to find the
+// monogenic signal. The frequency domain path evaluates response() at each
+// frequency of the DFT. Profiles that can be applied in the spatial domain at a
+// cost per pixel that does not depend on scale may also provide a recursive
+// implementation, which the processor may choose when it is cheaper
+class radialProfile
+{
+	public:
+
+	virtual ~radialProfile() {}
+
+	// The gain of the filter at radial frequency w (cycles per pixel)
+	virtual float response(const float w) const = 0;
+
+	// The frequency (cycles per pixel) at which the response peaks, which is
+	// used to scale the approximate Riesz transform of the recursive path
+	virtual float centreFrequency() const = 0;
+
+	// Whether applyRecursive is available, and if so, whether it matches
+	// response() to within the accuracy of the recursive filters
+	virtual bool hasRecursiveImplementation() const { return false; }
+	virtual bool recursiveIsExact() const { return false; }
+
+	// Approximate number of floating point operations per pixel used by
+	// applyRecursive
+	virtual float recursiveCostPerPixel() const { return 0.0f; }
+
+	// RMS difference between the radial profile of applyRecursive and
+	// response() (ignoring the error of the recursive filters themselves)
+	virtual float recursiveProfileError() const { return 0.0f; }
+
+	// Applies the band-pass filter in place to a single channel CV_32F image
+	virtual void applyRecursive(cv::Mat &im) const;
+};
+
+// The log Gabor profile, exp(-log(w/w0)^2 / (2 log(shape_sigma)^2)), as used by
+// default. The recursive implementation is the approximation by a difference
+// of Gaussians used by findMonogenicSignalRecursive
+class logGaborProfile : public radialProfile
+{
+	public:
+	logGaborProfile(const float wavelength, const float shape_sigma = 0.5);
+	float response(const float w) const;
+	float centreFrequency() const;
+	bool hasRecursiveImplementation() const { return true; }
+	float recursiveCostPerPixel() const;
+	float recursiveProfileError() const { return dog_rms; }
+	void applyRecursive(cv::Mat &im) const;
+
+	private:
+	float w0, scale_const, dog_sigma_1, dog_sigma_2, dog_gain, dog_rms;
+};
+
+// The Poisson (low-pass) profile, exp(-2.pi.scale.w). Combined with the Riesz
+// transform this gives the monogenic scale-space
+class poissonProfile : public radialProfile
+{
+	public:
+	poissonProfile(const float scale);
+	float response(const float w) const;
+	float centreFrequency() const;
+
+	private:
+	float s;
+};
+
+// The difference of Poisson profile with scales scale_1 < scale_2,
+// normalised to a peak of one
+class differenceOfPoissonProfile : public radialProfile
+{
+	public:
+	differenceOfPoissonProfile(const float scale_1, const float scale_2);
+	float response(const float w) const;
+	float centreFrequency() const;
+
+	private:
+	float s1, s2, w_peak, gain;
+};
+
+// The Cauchy profile, (w/w0)^order . exp(-order.(w/w0 - 1)), which peaks
+// with value one at the centre frequency
+class cauchyProfile : public radialProfile
+{
+	public:
+	cauchyProfile(const float wavelength, const float order);
+	float response(const float w) const;
+	float centreFrequency() const;
+
+	private:
+	float w0, a;
+};
+
+// The difference of Gaussians profile with standard deviations (in pixels)
+// sigma_1 < sigma_2, normalised to a peak of one. This has an exact recursive
+// implementation
+class differenceOfGaussiansProfile : public radialProfile
+{
+	public:
+	differenceOfGaussiansProfile(const float sigma_1, const float sigma_2);
+	float response(const float w) const;
+	float centreFrequency() const;
+	bool hasRecursiveImplementation() const { return true; }
+	bool recursiveIsExact() const { return true; }
+	float recursiveCostPerPixel() const;
+	void applyRecursive(cv::Mat &im) const;
+
+	private:
+	float sigma1, sigma2, w_peak, gain;
+};
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,130 @@
+#include "recursiveFilters.h"
+#include <limits>
+
+using namespace std;
+using namespace cv;
+
+namespace monogenic
+{
+
+// Find the coefficients of the Young and van Vliet filter, normalised such
+// that the feedback coefficients are divided by b0
+static void youngVanVlietCoeffs(const float sigma, float &B, float b[3])
+{
+	const double s = std::max(double(sigma),0.5);
+	const double q = (s >= 2.5) ? 0.98711*s - 0.96330 : 3.97156 - 4.14554*std::sqrt(1.0 - 0.26891*s);
+	const double q2 = q*q, q3 = q2*q;
+	const double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+	b[0] = (2.44413*q + 2.85619*q2 + 1.26661*q3) / b0;
+	b[1] = -(1.4281*q2 + 1.26661*q3) / b0;
+	b[2] = (0.422205*q3) / b0;
+	B = 1.0 - (b[0] + b[1] + b[2]);
+}
+
+// The filter is run causally and then anti-causally. The initial conditions
+// assume the signal continues with the value at the edge
+void recursiveGaussian(Mat &im, const float sigma)
+{
+	CV_Assert(im.type() == CV_32F);
+
+	float B, b[3];
+	youngVanVlietCoeffs(sigma,B,b);
+	const int rows = im.rows, cols = im.cols;
+
+	// Along the rows
+	#pragma omp parallel for
+	for(int j = 0; j < rows; ++j)
+	{
+		float* const p = im.ptr<float>(j);
+		float y1 = p[0], y2 = p[0], y3 = p[0];
+		for(int i = 0; i < cols; ++i)
+		{
+			const float y = B*p[i] + b[0]*y1 + b[1]*y2 + b[2]*y3;
+			y3 = y2;
+			y2 = y1;
+			y1 = y;
+			p[i] = y;
+		}
+		y1 = y2 = y3 = p[cols-1];
+		for(int i = cols - 1; i >= 0; --i)
+		{
+			const float y = B*p[i] + b[0]*y1 + b[1]*y2 + b[2]*y3;
+			y3 = y2;
+			y2 = y1;
+			y1 = y;
+			p[i] = y;
+		}
+	}
+
+	// Along the columns, working across each row at once so that memory is
+	// accessed contiguously, with threads working on separate sets of columns
+	const int col_chunk = 256;
+	const int n_chunks = (cols + col_chunk - 1) / col_chunk;
+	#pragma omp parallel for
+	for(int c = 0; c < n_chunks; ++c)
+	{
+		const int i_start = c*col_chunk, i_end = std::min((c+1)*col_chunk,cols);
+		for(int j = 0; j < rows; ++j)
+		{
+			float* const p = im.ptr<float>(j);
+			const float* const p1 = im.ptr<float>(std::max(j-1,0));
+			const float* const p2 = im.ptr<float>(std::max(j-2,0));
+			const float* const p3 = im.ptr<float>(std::max(j-3,0));
+			for(int i = i_start; i < i_end; ++i)
+				p[i] = B*p[i] + b[0]*p1[i] + b[1]*p2[i] + b[2]*p3[i];
+		}
+		for(int j = rows - 1; j >= 0; --j)
+		{
+			float* const p = im.ptr<float>(j);
+			const float* const p1 = im.ptr<float>(std::min(j+1,rows-1));
+			const float* const p2 = im.ptr<float>(std::min(j+2,rows-1));
+			const float* const p3 = im.ptr<float>(std::min(j+3,rows-1));
+			for(int i = i_start; i < i_end; ++i)
+				p[i] = B*p[i] + b[0]*p1[i] + b[1]*p2[i] + b[2]*p3[i];
+		}
+	}
+}
+
+// Search over the ratio of the two standard deviations, with the first
+// standard deviation chosen to put the peak of the difference at the centre
+// frequency. The profiles are compared at logarithmically spaced frequencies
+// with a weighting proportional to the area of the 2D spectrum they represent
+void fitDoGToLogGabor(const float wavelength, const float shape_sigma, float &sigma_1, float &sigma_2, float &gain, float &rms_error)
+{
+	const int n_ratios = 200, n_freqs = 256;
+	const double w0 = 1.0/wavelength;
+	const double scale_const = 1.0/(2.0*std::log(shape_sigma)*std::log(shape_sigma));
+	const double two_pi_sq = 2.0*CV_PI*CV_PI;
+	const double w_min = w0/64.0, w_max = 0.5*std::sqrt(2.0);
+
+	double best_err = std::numeric_limits<double>::max();
+	for(int r = 0; r < n_ratios; ++r)
+	{
+		const double k = std::exp(std::log(1.05) + (std::log(10.0) - std::log(1.05))*r/(n_ratios - 1));
+		const double s1_sq = std::log(k*k) / (two_pi_sq*w0*w0*(k*k - 1.0));
+		const double s2_sq = k*k*s1_sq;
+		const double peak = std::exp(-two_pi_sq*s1_sq*w0*w0) - std::exp(-two_pi_sq*s2_sq*w0*w0);
+
+		double err = 0.0, weight_sum = 0.0;
+		for(int f = 0; f < n_freqs; ++f)
+		{
+			const double w = std::exp(std::log(w_min) + (std::log(w_max) - std::log(w_min))*f/(n_freqs - 1));
+			const double lg = std::exp(-std::pow(std::log(w/w0),2.0)*scale_const);
+			const double dog = (std::exp(-two_pi_sq*s1_sq*w*w) - std::exp(-two_pi_sq*s2_sq*w*w)) / peak;
+			const double weight = w*w;
+			err += weight*(dog - lg)*(dog - lg);
+			weight_sum += weight;
+		}
+
+		if(err < best_err)
+		{
+			best_err = err;
+			sigma_1 = std::sqrt(s1_sq);
+			sigma_2 = std::sqrt(s2_sq);
+			gain = 1.0/peak;
+			rms_error = std::sqrt(err/weight_sum);
+		}
+	}
+}
+
+} // end of namespace
@@ -0,0 +1,310 @@
+#include "stageProfiler.h"
+#include "processorMetrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+namespace monogenic
+{
+
+static const char* const C_STAGE_NAMES[N_PROCESSING_STAGES] =
+{
+	"input",
+	"filtering",
+	"recursive",
+	"temporal",
+	"split",
+	"magnitudes",
+	"amplitude",
+	"symmetry",
+	"oriented_symmetry",
+	"local_phase",
+	"fused_outputs",
+	"backward"
+};
+
+const char* stageName(const processingStage stage)
+{
+	return C_STAGE_NAMES[stage];
+}
+
+static double nowMs()
+{
+	return std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef __linux__
+// Cycles, instructions, cache misses (usually the last level cache) and
+// cycles stalled in the back end
+static const uint64_t C_COUNTER_CONFIGS[4] =
+{
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_STALLED_CYCLES_BACKEND
+};
+
+// Open a user space counter for the calling thread on any CPU
+static int openCounter(const uint64_t config)
+{
+	perf_event_attr attr;
+	memset(&attr,0,sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return int(syscall(__NR_perf_event_open,&attr,0,-1,-1,0));
+}
+#endif
+
+double stageStatistics::ipc() const
+{
+	return ((cycles > 0) && (instructions >= 0)) ? double(instructions)/double(cycles) : -1.0;
+}
+
+double stageStatistics::bandwidth(const int cache_line_bytes) const
+{
+	return ((llc_misses >= 0) && (total_ms > 0.0)) ? double(llc_misses)*cache_line_bytes/(0.001*total_ms) : -1.0;
+}
+
+double stageStatistics::stallFraction() const
+{
+	return ((cycles > 0) && (stall_cycles >= 0)) ? double(stall_cycles)/double(cycles) : -1.0;
+}
+
+stageProfiler::stageProfiler()
+: enabled(false), suspended(false), start_ms(0.0)
+{
+	for(int c = 0; c < C_N_COUNTERS; ++c)
+	{
+		counter_open[c] = false;
+		start_counts[c] = 0;
+	}
+	reset();
+}
+
+stageProfiler::~stageProfiler()
+{
+	closeCounters();
+}
+
+stageProfiler::stageProfiler(const stageProfiler &other)
+: enabled(false), suspended(false), metrics(other.metrics), start_ms(0.0)
+{
+	for(int c = 0; c < C_N_COUNTERS; ++c)
+	{
+		counter_open[c] = false;
+		start_counts[c] = 0;
+	}
+	copyResults(other);
+}
+
+stageProfiler& stageProfiler::operator=(const stageProfiler &other)
+{
+	if(this != &other)
+	{
+		disable();
+		metrics = other.metrics;
+		copyResults(other);
+	}
+	return *this;
+}
+
+// Only the timings survive a copy, since the copy has no open counters
+void stageProfiler::copyResults(const stageProfiler &other)
+{
+	for(int s = 0; s < N_PROCESSING_STAGES; ++s)
+	{
+		calls[s] = other.calls[s];
+		total_ms[s] = other.total_ms[s];
+		min_ms[s] = other.min_ms[s];
+		max_ms[s] = other.max_ms[s];
+		for(int c = 0; c < C_N_COUNTERS; ++c)
+			totals[s][c] = other.totals[s][c];
+	}
+}
+
+void stageProfiler::enable(const bool hardware_counters)
+{
+	closeCounters();
+	if(hardware_counters)
+		openCounters();
+	reset();
+	enabled = true;
+}
+
+void stageProfiler::disable()
+{
+	enabled = false;
+	closeCounters();
+}
+
+void stageProfiler::setSuspended(const bool suspend)
+{
+	suspended = suspend;
+}
+
+void stageProfiler::setMetrics(const std::shared_ptr<processorMetrics> &stage_metrics)
+{
+	metrics = stage_metrics;
+}
+
+bool stageProfiler::countersAvailable() const
+{
+	for(int c = 0; c < C_N_COUNTERS; ++c)
+		if(counter_open[c]) return true;
+	return false;
+}
+
+// Each thread of the OpenMP team opens its own counters. A counter is only
+// used if it could be opened for every thread, so that the sums are complete
+void stageProfiler::openCounters()
+{
+	#ifdef _OPENMP
+	const int n_threads = omp_get_max_threads();
+	#else
+	const int n_threads = 1;
+	#endif
+
+	counter_fds.assign(n_threads*C_N_COUNTERS,-1);
+
+	#ifdef __linux__
+	#pragma omp parallel num_threads(n_threads)
+	{
+		#ifdef _OPENMP
+		const int t = omp_get_thread_num();
+		#else
+		const int t = 0;
+		#endif
+		for(int c = 0; c < C_N_COUNTERS; ++c)
+			counter_fds[t*C_N_COUNTERS + c] = openCounter(C_COUNTER_CONFIGS[c]);
+	}
+	#endif
+
+	for(int c = 0; c < C_N_COUNTERS; ++c)
+	{
+		counter_open[c] = true;
+		for(int t = 0; t < n_threads; ++t)
+			if(counter_fds[t*C_N_COUNTERS + c] < 0) counter_open[c] = false;
+	}
+}
+
+void stageProfiler::closeCounters()
+{
+	#ifdef __linux__
+	for(size_t k = 0; k < counter_fds.size(); ++k)
+		if(counter_fds[k] >= 0) close(counter_fds[k]);
+	#endif
+	counter_fds.clear();
+	for(int c = 0; c < C_N_COUNTERS; ++c)
+		counter_open[c] = false;
+}
+
+// Sum each counter over the threads
+void stageProfiler::readCounters(int64_t values[C_N_COUNTERS]) const
+{
+	const int n_threads = counter_fds.size() / C_N_COUNTERS;
+	for(int c = 0; c < C_N_COUNTERS; ++c)
+	{
+		values[c] = 0;
+		if(!counter_open[c]) continue;
+		#ifdef __linux__
+		for(int t = 0; t < n_threads; ++t)
+		{
+			uint64_t count = 0;
+			if(read(counter_fds[t*C_N_COUNTERS + c],&count,sizeof(count)) == sizeof(count))
+				values[c] += int64_t(count);
+		}
+		#else
+		(void) n_threads;
+		#endif
+	}
+}
+
+void stageProfiler::begin(const processingStage stage)
+{
+	(void) stage;
+	if(enabled)
+		readCounters(start_counts);
+	start_ms = nowMs();
+}
+
+void stageProfiler::end(const processingStage stage)
+{
+	const double elapsed = nowMs() - start_ms;
+	if(metrics)
+		metrics->recordStage(stage,elapsed);
+	if(!enabled)
+		return;
+
+	int64_t counts[C_N_COUNTERS];
+	readCounters(counts);
+
+	++calls[stage];
+	total_ms[stage] += elapsed;
+	min_ms[stage] = std::min(min_ms[stage],elapsed);
+	max_ms[stage] = std::max(max_ms[stage],elapsed);
+	for(int c = 0; c < C_N_COUNTERS; ++c)
+		if(counter_open[c]) totals[stage][c] += counts[c] - start_counts[c];
+}
+
+void stageProfiler::getStatistics(vector<stageStatistics> &stats) const
+{
+	stats.clear();
+	for(int s = 0; s < N_PROCESSING_STAGES; ++s)
+	{
+		if(calls[s] == 0) continue;
+		stageStatistics st;
+		st.name = stageName(processingStage(s));
+		st.calls = calls[s];
+		st.total_ms = total_ms[s];
+		st.min_ms = min_ms[s];
+		st.max_ms = max_ms[s];
+		st.cycles = counter_open[0] ? totals[s][0] : -1;
+		st.instructions = counter_open[1] ? totals[s][1] : -1;
+		st.llc_misses = counter_open[2] ? totals[s][2] : -1;
+		st.stall_cycles = counter_open[3] ? totals[s][3] : -1;
+		stats.push_back(st);
+	}
+}
+
+void stageProfiler::reset()
+{
+	for(int s = 0; s < N_PROCESSING_STAGES; ++s)
+	{
+		calls[s] = 0;
+		total_ms[s] = 0.0;
+		min_ms[s] = std::numeric_limits<double>::max();
+		max_ms[s] = 0.0;
+		for(int c = 0; c < C_N_COUNTERS; ++c)
+			totals[s][c] = 0;
+	}
+}
+
+void writeStageStatistics(ostream &os, const vector<stageStatistics> &stats)
+{
+	os << "stage\tcalls\ttotal_ms\tmean_ms\tmin_ms\tmax_ms\tcycles\tinstructions\tllc_misses\tstall_cycles\tipc\tbandwidth_GBps\tstall_fraction" << endl;
+	for(size_t k = 0; k < stats.size(); ++k)
+	{
+		const stageStatistics &st = stats[k];
+		const double bw = st.bandwidth();
+		os << st.name << "\t" << st.calls << "\t" << st.total_ms << "\t" << st.total_ms/st.calls << "\t"
+		   << st.min_ms << "\t" << st.max_ms << "\t" << st.cycles << "\t" << st.instructions << "\t"
+		   << st.llc_misses << "\t" << st.stall_cycles << "\t" << st.ipc() << "\t"
+		   << ((bw >= 0.0) ? 1e-9*bw : -1.0) << "\t" << st.stallFraction() << endl;
+	}
+}
+
+} // end of namespace
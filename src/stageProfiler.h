@@ -0,0 +1,156 @@
+#ifndef STAGEPROFILER_H
+#define STAGEPROFILER_H
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace monogenic
+{
+
+// The stages of processing that are timed separately by the profiler. The
+// calculations of derived outputs are timed without the calculations of the
+// outputs they depend on
+enum processingStage
+{
+	STAGE_INPUT,                // padding the image and taking its DFT
+	STAGE_FILTERING,            // spectral multiplication and inverse DFTs
+	STAGE_RECURSIVE,            // recursive approximation of the filters
+	STAGE_TEMPORAL,             // updating the temporal filter
+	STAGE_SPLIT,                // splitting the responses into planes
+	STAGE_MAGNITUDES,           // magnitudes of the even and odd parts and orientation
+	STAGE_AMPLITUDE,            // local amplitude
+	STAGE_SYMMETRY,             // feature symmetry and asymmetry
+	STAGE_ORIENTED_SYMMETRY,    // positive and negative feature symmetry
+	STAGE_LOCAL_PHASE,          // local phase
+	STAGE_FUSED_OUTPUTS,        // outputs found in one pass in latency mode
+	STAGE_BACKWARD,             // gradients found by the backward pass
+	N_PROCESSING_STAGES
+};
+
+class processorMetrics;
+
+// Name of a stage as used in reports (e.g. "oriented_symmetry")
+const char* stageName(const processingStage stage);
+
+// Aggregated measurements of one stage. Hardware counts are summed over all
+// of the threads that the profiler monitors, and are negative if the counter
+// could not be opened on this system (e.g. when not on Linux, when
+// perf_event_paranoid forbids it, or when the CPU lacks the event)
+struct stageStatistics
+{
+	std::string name;
+	long calls;
+	double total_ms, min_ms, max_ms;
+	int64_t cycles, instructions, llc_misses, stall_cycles;
+
+	// Instructions per cycle, or a negative value if not measured
+	double ipc() const;
+
+	// Estimate of the memory bandwidth (bytes per second) as the traffic due to
+	// last level cache misses over the time taken, or a negative value if not
+	// measured
+	double bandwidth(const int cache_line_bytes = 64) const;
+
+	// Proportion of cycles stalled waiting on the back end (mostly memory), or
+	// a negative value if not measured
+	double stallFraction() const;
+};
+
+// Times the stages of processing, and optionally reads the Linux
+// perf_event_open hardware counters (cycles, instructions, last level cache
+// misses and back end stall cycles) around each stage. The counters are opened
+// for each of the OpenMP threads existing when profiling is enabled, so that
+// work done by the worker threads is included. Counting is restricted to user
+// space so that it works with the default perf_event_paranoid setting. The
+// duration of each stage may also be passed to a metrics object, which is
+// independent of whether profiling is enabled
+class stageProfiler
+{
+	public:
+
+	stageProfiler();
+	~stageProfiler();
+
+	// Copies keep the results and the metrics object, but do not share the
+	// counters, so are not enabled
+	stageProfiler(const stageProfiler &other);
+	stageProfiler& operator=(const stageProfiler &other);
+
+	// Starts profiling (clearing previous results), with or without the
+	// hardware counters
+	void enable(const bool hardware_counters = true);
+
+	// Stops profiling and closes the counters, keeping the results
+	void disable();
+
+	bool isEnabled() const { return enabled; }
+
+	// While suspended, stages are neither measured nor passed to the metrics
+	// object (e.g. while warming up), but the counters stay open and the
+	// results are kept
+	void setSuspended(const bool suspend);
+
+	// Sets the metrics object to receive the duration of each stage (or none if
+	// null)
+	void setMetrics(const std::shared_ptr<processorMetrics> &stage_metrics);
+
+	// Whether stages need to be marked at all
+	bool isActive() const { return !suspended && (enabled || metrics); }
+
+	// Whether any hardware counter could be opened
+	bool countersAvailable() const;
+
+	// Mark the start and end of a stage. Stages must not be nested
+	void begin(const processingStage stage);
+	void end(const processingStage stage);
+
+	// Returns the statistics of the stages that have been run at least once
+	void getStatistics(std::vector<stageStatistics> &stats) const;
+
+	// Clears the results
+	void reset();
+
+	// Marks a stage for the lifetime of the object (if the profiler is active)
+	class scope
+	{
+		public:
+		scope(stageProfiler &profiler, const processingStage stage)
+		: prof(profiler), st(stage), active(profiler.isActive()) { if(active) prof.begin(st); }
+		~scope() { if(active) prof.end(st); }
+
+		private:
+		scope(const scope&);
+		scope& operator=(const scope&);
+		stageProfiler &prof;
+		const processingStage st;
+		const bool active;
+	};
+
+	private:
+
+	static const int C_N_COUNTERS = 4;
+
+	void openCounters();
+	void closeCounters();
+	void readCounters(int64_t values[C_N_COUNTERS]) const;
+	void copyResults(const stageProfiler &other);
+
+	bool enabled, suspended;
+	std::shared_ptr<processorMetrics> metrics;
+	std::vector<int> counter_fds;        // C_N_COUNTERS per monitored thread
+	bool counter_open[C_N_COUNTERS];
+	int64_t start_counts[C_N_COUNTERS];
+	double start_ms;
+	long calls[N_PROCESSING_STAGES];
+	double total_ms[N_PROCESSING_STAGES], min_ms[N_PROCESSING_STAGES], max_ms[N_PROCESSING_STAGES];
+	int64_t totals[N_PROCESSING_STAGES][C_N_COUNTERS];
+};
+
+// Writes statistics as a table with one line per stage
+void writeStageStatistics(std::ostream &os, const std::vector<stageStatistics> &stats);
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,135 @@
+#include "tensorExport.h"
+#include <memory>
+
+using namespace std;
+using namespace cv;
+
+namespace monogenic
+{
+
+void getImageBatch(monogenicProcessor &processor, const vector<Mat> &images, const vector<outputType> &outputs, Mat &batch)
+{
+	if(images.empty() || outputs.empty())
+		CV_Error(cv::Error::StsBadArg,"At least one image and one output are needed");
+
+	const Size image_size = images[0].size();
+	const int n_images = images.size();
+	const int n_outputs = outputs.size();
+	const int dims[4] = {n_images,n_outputs,image_size.height,image_size.width};
+	batch.create(4,dims,CV_32F);
+
+	const size_t item_size = size_t(n_outputs)*image_size.height*image_size.width;
+	const int item_dims[3] = {n_outputs,image_size.height,image_size.width};
+	for(int n = 0; n < n_images; ++n)
+	{
+		if(images[n].size() != image_size)
+			CV_Error(cv::Error::StsBadArg,"The images must all be the same size");
+
+		// A header for this image's slice of the batch, which getInterleaved
+		// writes in place as it already has the required size and type
+		float* const item_ptr = batch.ptr<float>() + n*item_size;
+		Mat item(3,item_dims,CV_32F,item_ptr);
+		processor.findMonogenicSignal(images[n]);
+		processor.getInterleaved(outputs,item,LAYOUT_CHW);
+		if(item.ptr<float>() != item_ptr)
+			CV_Error(cv::Error::StsBadArg,"The images must have the size that the processor was initialised with");
+	}
+}
+
+#ifdef MONOGENIC_HAVE_DLPACK
+
+// The matrix whose buffer is shared, along with the storage for the shape
+// and strides, kept alive until the consumer calls the deleter
+struct dlpackContext
+{
+	Mat mat;
+	vector<int64_t> shape, strides;
+	DLManagedTensor tensor;
+};
+
+static void deleteContext(DLManagedTensor *self)
+{
+	delete static_cast<dlpackContext*>(self->manager_ctx);
+}
+
+static DLDataType dlpackType(const int depth)
+{
+	DLDataType type;
+	type.lanes = 1;
+	switch(depth)
+	{
+		case CV_8U:  type.code = kDLUInt;  type.bits = 8;  break;
+		case CV_8S:  type.code = kDLInt;   type.bits = 8;  break;
+		case CV_16U: type.code = kDLUInt;  type.bits = 16; break;
+		case CV_16S: type.code = kDLInt;   type.bits = 16; break;
+		case CV_32S: type.code = kDLInt;   type.bits = 32; break;
+		case CV_32F: type.code = kDLFloat; type.bits = 32; break;
+		case CV_64F: type.code = kDLFloat; type.bits = 64; break;
+		case CV_16F: type.code = kDLFloat; type.bits = 16; break;
+		default:
+			CV_Error(cv::Error::StsUnsupportedFormat,"The matrix type has no DLPack equivalent");
+	}
+	return type;
+}
+
+DLManagedTensor* toDLPack(const Mat &m)
+{
+	if(m.empty())
+		CV_Error(cv::Error::StsBadArg,"Cannot export an empty matrix");
+
+	// The context is only handed to the tensor once it is complete, so that it
+	// is freed if an error is raised (e.g. for an unsupported type)
+	std::unique_ptr<dlpackContext> ctx(new dlpackContext);
+	ctx->mat = m;
+
+	// DLPack strides are in elements rather than bytes
+	const size_t elem_size = m.elemSize1();
+	for(int d = 0; d < m.dims; ++d)
+	{
+		ctx->shape.push_back(m.size[d]);
+		ctx->strides.push_back(int64_t(m.step[d] / elem_size));
+	}
+	if(m.channels() > 1)
+	{
+		ctx->shape.push_back(m.channels());
+		ctx->strides.push_back(1);
+	}
+
+	DLTensor &t = ctx->tensor.dl_tensor;
+	t.data = ctx->mat.data;
+	t.device.device_type = kDLCPU;
+	t.device.device_id = 0;
+	t.ndim = ctx->shape.size();
+	t.dtype = dlpackType(m.depth());
+	t.shape = ctx->shape.data();
+	t.strides = ctx->strides.data();
+	t.byte_offset = 0;
+	ctx->tensor.deleter = deleteContext;
+	ctx->tensor.manager_ctx = ctx.get();
+	return &ctx.release()->tensor;
+}
+
+DLManagedTensor* exportOutputs(monogenicProcessor &processor, const vector<outputType> &outputs, const tensorLayout layout)
+{
+	Mat result;
+	processor.getInterleaved(outputs,result,layout);
+	return toDLPack(result);
+}
+
+DLManagedTensor* exportCropBatch(monogenicProcessor &processor, const vector<Point> &origins, const Size &crop_size, const vector<outputType> &outputs)
+{
+	Mat batch;
+	processor.getCropBatch(origins,crop_size,outputs,batch);
+	return toDLPack(batch);
+}
+
+DLManagedTensor* exportImageBatch(monogenicProcessor &processor, const vector<Mat> &images, const vector<outputType> &outputs)
+{
+	Mat batch;
+	getImageBatch(processor,images,outputs,batch);
+	return toDLPack(batch);
+}
+
+#endif
+
+} // end of namespace
@@ -0,0 +1,59 @@
+#ifndef TENSOREXPORT_H
+#define TENSOREXPORT_H
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "monogenicProcessor.h"
+#ifdef MONOGENIC_HAVE_DLPACK
+#include <dlpack/dlpack.h>
+#endif
+
+namespace monogenic
+{
+
+// Processes each of the images in turn and writes the listed outputs of each
+// over the original image area into a single contiguous 4D CV_32F matrix
+// (images x outputs x height x width). Each image's outputs are written
+// directly into its slice of the batch by getInterleaved, so the batch is
+// filled without further copies. The images must have the size that the
+// processor was initialised with, and the processor holds the result for the
+// last image afterwards
+void getImageBatch(monogenicProcessor &processor, const std::vector<cv::Mat> &images, const std::vector<outputType> &outputs, cv::Mat &batch);
+
+#ifdef MONOGENIC_HAVE_DLPACK
+
+// The following functions are available when the library is built with
+// DLPack (version 0.6 or later), and return tensors on the CPU for
+// frameworks such as PyTorch and ONNX Runtime to consume without copying.
+// Each tensor holds a reference to the buffer of a cv::Mat, which is only
+// freed when both the tensor's deleter has been called by the consumer and
+// any other matrices sharing the buffer have been released
+
+// Wraps a matrix as a DLPack tensor sharing its buffer. The shape is the
+// dimensions of the matrix followed by the number of channels if more than
+// one, with the strides of the matrix, so matrices that are not continuous
+// (such as regions of interest) are described correctly. If the matrix does
+// not own its data (e.g. it is a header for external memory), that memory
+// must outlive the tensor. Note that the processor reuses its output buffers
+// for the next image, so outputs from getOutput should be cloned or
+// exported with exportOutputs instead
+DLManagedTensor* toDLPack(const cv::Mat &m);
+
+// Exports the listed outputs of the image most recently passed to
+// findMonogenicSignal as one tensor in the given layout (outputs x height x
+// width for LAYOUT_CHW, or height x width x outputs for LAYOUT_HWC). The
+// outputs are written to a new buffer owned by the tensor alone
+DLManagedTensor* exportOutputs(monogenicProcessor &processor, const std::vector<outputType> &outputs, const tensorLayout layout = LAYOUT_CHW);
+
+// Exports a batch of crops (see monogenicProcessor::getCropBatch) as a
+// crops x outputs x height x width tensor
+DLManagedTensor* exportCropBatch(monogenicProcessor &processor, const std::vector<cv::Point> &origins, const cv::Size &crop_size, const std::vector<outputType> &outputs);
+
+// Exports the outputs of a batch of images (see getImageBatch) as an
+// images x outputs x height x width tensor
+DLManagedTensor* exportImageBatch(monogenicProcessor &processor, const std::vector<cv::Mat> &images, const std::vector<outputType> &outputs);
+
+#endif
+
+} // end of namespace
+
+#endif